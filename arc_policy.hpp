@@ -0,0 +1,150 @@
+#ifndef ARC_CACHE_POLICY_HPP
+#define ARC_CACHE_POLICY_HPP
+
+#include "cache_policy.hpp"
+#include "key_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace caches
+{
+    /*
+     * ARC (Adaptive Replacement Cache) Policy
+     * Resident keys are split between T1 (seen once recently) and T2 (seen at
+     * least twice). Evicted keys are remembered in the ghost lists B1/B2;
+     * a miss that hits a ghost list shifts the target size p of T1 towards
+     * recency (B1) or frequency (B2), so the policy tunes itself to the
+     * workload. Ghosts hold no values and are capped at the capacity c, so the
+     * policy tracks at most 2c keys in a pool sized once by Reserve.
+     */
+    template <typename Key>
+    class ARCCachePolicy
+    {
+    public:
+        using node_id = typename key_pool<Key>::index_type;
+
+        ARCCachePolicy() = default;
+        ~ARCCachePolicy() noexcept = default;
+
+        void Reserve(std::size_t capacity) {
+            SetCapacity(capacity);
+        }
+
+        void Insert(const Key& key) {
+            node_id id = key_nodes.find(key);
+            if (id != key_pool<Key>::npos && IsResident(id)) return; // prevent duplicate
+
+            // Without a Reserve hint (weighted caches) follow the resident count
+            if (t1.size + t2.size + 1 > capacity) SetCapacity(std::max<std::size_t>(2 * capacity, 64));
+
+            if (id != key_pool<Key>::npos) {
+                // Ghost hit: the key was evicted too early, adapt p towards
+                // the list that would have kept it
+                if (key_nodes.tag(id) == b1_list) {
+                    const std::size_t delta = std::max<std::size_t>(b2.size / std::max<std::size_t>(b1.size, 1), 1);
+                    target_t1 = std::min(capacity, target_t1 + delta);
+                    key_nodes.unlink(b1, id);
+                } else {
+                    const std::size_t delta = std::max<std::size_t>(b1.size / std::max<std::size_t>(b2.size, 1), 1);
+                    target_t1 = target_t1 > delta ? target_t1 - delta : 0;
+                    key_nodes.unlink(b2, id);
+                }
+                Push(t2, t2_list, id);
+            } else {
+                Push(t1, t1_list, key_nodes.insert(key));
+            }
+
+            TrimGhosts();
+        }
+
+        void Touch(const Key& key) {
+            const node_id id = key_nodes.find(key);
+            if (id == key_pool<Key>::npos || !IsResident(id)) return;
+
+            if (key_nodes.tag(id) == t1_list) {
+                key_nodes.unlink(t1, id);
+                Push(t2, t2_list, id);
+            } else {
+                key_nodes.move_to_front(t2, id);
+            }
+        }
+
+        void Prefetch(const Key& key) const noexcept {
+            key_nodes.prefetch(key);
+        }
+
+        void Erase(const Key& key) noexcept {
+            const node_id id = key_nodes.find(key);
+            if (id == key_pool<Key>::npos || !IsResident(id)) return;
+
+            // The key leaves the cache but stays known as a ghost
+            if (key_nodes.tag(id) == t1_list) {
+                key_nodes.unlink(t1, id);
+                Push(b1, b1_list, id);
+            } else {
+                key_nodes.unlink(t2, id);
+                Push(b2, b2_list, id);
+            }
+            TrimGhosts();
+        }
+
+        const Key& ReplacementCandidate() const {
+            if (t1.size + t2.size == 0) {
+                throw std::runtime_error("No keys available for eviction (ARC).");
+            }
+            // REPLACE: take from T1 while it is above its target size
+            if (t1.size != 0 && (t1.size > target_t1 || t2.size == 0)) {
+                return key_nodes.key(t1.tail);
+            }
+            return key_nodes.key(t2.tail);
+        }
+
+    private:
+        static constexpr std::uint8_t t1_list = 0;
+        static constexpr std::uint8_t t2_list = 1;
+        static constexpr std::uint8_t b1_list = 2;
+        static constexpr std::uint8_t b2_list = 3;
+
+        bool IsResident(node_id id) const noexcept { return key_nodes.tag(id) <= t2_list; }
+
+        void SetCapacity(std::size_t new_capacity) {
+            capacity = std::max<std::size_t>(new_capacity, 1);
+            target_t1 = std::min(target_t1, capacity);
+            key_nodes.reserve(2 * capacity + 1);
+            TrimGhosts();
+        }
+
+        // |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c
+        void TrimGhosts() noexcept {
+            while (t1.size + b1.size > capacity && b1.size != 0) DropGhost(b1);
+            while (t1.size + t2.size + b1.size + b2.size > 2 * capacity) {
+                if (b2.size != 0) DropGhost(b2);
+                else if (b1.size != 0) DropGhost(b1);
+                else break;
+            }
+        }
+
+        void DropGhost(typename key_pool<Key>::list& ghosts) noexcept {
+            const node_id id = ghosts.tail;
+            key_nodes.unlink(ghosts, id);
+            key_nodes.erase(id);
+        }
+
+        void Push(typename key_pool<Key>::list& l, std::uint8_t tag, node_id id) noexcept {
+            key_nodes.push_front(l, id);
+            key_nodes.set_tag(id, tag);
+        }
+
+        key_pool<Key> key_nodes;
+        typename key_pool<Key>::list t1; // resident, seen once
+        typename key_pool<Key>::list t2; // resident, seen at least twice
+        typename key_pool<Key>::list b1; // ghosts evicted from T1
+        typename key_pool<Key>::list b2; // ghosts evicted from T2
+        std::size_t capacity = 0;
+        std::size_t target_t1 = 0;       // p
+    };
+}
+
+#endif
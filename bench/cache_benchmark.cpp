@@ -0,0 +1,139 @@
+/*
+ * Throughput of every policy x HashMap backend x key type.
+ *
+ *   g++ -std=c++17 -O2 -DNDEBUG -I. bench/cache_benchmark.cpp -o cache_benchmark -lbenchmark -lpthread
+ *   ./cache_benchmark --benchmark_filter='LRU/flat_hash_map/.*'
+ *
+ * Benchmark names are Policy/Backend/KeyType/Workload:
+ *   PutEvicting - Put over 4x capacity distinct keys, so nearly every Put evicts
+ *   TryGetHit   - TryGet of resident keys in random order
+ *   Zipf        - read-through (TryGet, Put on miss) of a Zipf(0.99) stream
+ *   Scan        - the Zipf stream interrupted by scans of one-off keys
+ * Zipf and Scan report the hit ratio in the hit_ratio counter.
+ */
+#include "bench/workloads.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t capacity = 1 << 14;
+    constexpr std::size_t universe = 1 << 17;      // distinct keys of the Zipf streams
+    constexpr std::size_t stream_length = 1 << 20;
+
+    template <typename Keys>
+    const std::vector<typename Keys::type>& ZipfKeys()
+    {
+        static const auto keys = bench::MakeKeys<Keys>(bench::ZipfStream(universe, stream_length));
+        return keys;
+    }
+
+    template <typename Keys>
+    const std::vector<typename Keys::type>& ScanKeys()
+    {
+        static const auto keys = bench::MakeKeys<Keys>(bench::ScanStream(universe, stream_length, 2 * capacity, capacity));
+        return keys;
+    }
+
+    template <typename Keys>
+    std::vector<typename Keys::type> DistinctKeys(std::size_t count)
+    {
+        std::vector<std::uint64_t> ids(count);
+        for (std::size_t i = 0; i < count; ++i) ids[i] = caches::mix_hash(i + 1);
+        return bench::MakeKeys<Keys>(ids);
+    }
+
+    template <typename Cache, typename Keys>
+    void PutEvicting(benchmark::State& state)
+    {
+        const auto keys = DistinctKeys<Keys>(4 * capacity);
+        Cache cache{capacity};
+        std::size_t i = 0;
+        for (auto _ : state)
+        {
+            cache.Put(keys[i], static_cast<int>(i));
+            if (++i == keys.size()) i = 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    template <typename Cache, typename Keys>
+    void TryGetHit(benchmark::State& state)
+    {
+        auto keys = DistinctKeys<Keys>(capacity);
+        Cache cache{capacity};
+        for (const auto& key : keys) cache.Put(key, 1);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937_64{7});
+
+        std::size_t i = 0;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(cache.TryGet(keys[i]));
+            if (++i == keys.size()) i = 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    template <typename Cache, typename Key>
+    void ReadThrough(benchmark::State& state, const std::vector<Key>& keys)
+    {
+        Cache cache{capacity};
+        // Warm up so the hit ratio reflects the steady state
+        bench::Replay(cache, std::vector<Key>(keys.begin(), keys.begin() + 4 * capacity));
+
+        std::size_t i = 0;
+        std::size_t hits = 0;
+        for (auto _ : state)
+        {
+            if (cache.TryGet(keys[i]).second)
+            {
+                ++hits;
+            }
+            else
+            {
+                cache.Put(keys[i], 0);
+            }
+            if (++i == keys.size()) i = 0;
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.counters["hit_ratio"] = static_cast<double>(hits) / static_cast<double>(state.iterations());
+    }
+
+    template <template <typename> class Policy, template <typename, typename> class Map, typename Keys>
+    void Register(bench::policy_tag<Policy>, bench::backend_tag<Map>, bench::key_tag<Keys>, const std::string& name)
+    {
+        using key_type = typename Keys::type;
+        using cache_type = caches::fixed_sized_cache<key_type, int, Policy, Map<key_type, int>>;
+
+        benchmark::RegisterBenchmark((name + "/PutEvicting").c_str(), PutEvicting<cache_type, Keys>);
+        benchmark::RegisterBenchmark((name + "/TryGetHit").c_str(), TryGetHit<cache_type, Keys>);
+        benchmark::RegisterBenchmark((name + "/Zipf").c_str(), [](benchmark::State& state) {
+            ReadThrough<cache_type>(state, ZipfKeys<Keys>());
+        });
+        benchmark::RegisterBenchmark((name + "/Scan").c_str(), [](benchmark::State& state) {
+            ReadThrough<cache_type>(state, ScanKeys<Keys>());
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bench::ForEachPolicy([](auto policy, const char* policy_name) {
+        bench::ForEachBackend([&](auto backend, const char* backend_name) {
+            bench::ForEachKeyType([&](auto keys, const char* key_name) {
+                Register(policy, backend, keys, std::string{policy_name} + "/" + backend_name + "/" + key_name);
+            });
+        });
+    });
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
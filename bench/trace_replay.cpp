@@ -0,0 +1,176 @@
+/*
+ * Replays a recorded key stream through every policy and reports the hit
+ * ratio and throughput of a read-through cache (TryGet, Put on a miss).
+ *
+ *   g++ -std=c++17 -O2 -DNDEBUG -I. bench/trace_replay.cpp -o trace_replay
+ *   ./trace_replay --format=arc --capacity=1000,10000 OLTP.lis
+ *
+ * Options:
+ *   --format=text|lirs|arc  text: one key per line (default)
+ *                           lirs: one block number per line (LIRS .trc)
+ *                           arc:  "start count ignored request" per line,
+ *                                 expanded to blocks start..start+count-1
+ *   --capacity=N[,N...]     cache capacities to try (default 1000)
+ *   --policy=NAME           a single policy (None, FIFO, LIFO, LRU, CLOCK,
+ *                           TinyLFU, ARC, 2Q); all by default
+ *   --backend=NAME          unordered_map (default) or flat_hash_map
+ */
+#include "bench/workloads.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct options
+    {
+        std::string format = "text";
+        std::vector<std::size_t> capacities;
+        std::string policy = "all";
+        std::string backend = "unordered_map";
+        std::string path;
+    };
+
+    std::vector<std::size_t> ParseCapacities(const std::string& list)
+    {
+        std::vector<std::size_t> capacities;
+        std::stringstream stream{list};
+        for (std::string item; std::getline(stream, item, ',');)
+        {
+            capacities.push_back(std::stoull(item));
+            if (capacities.back() == 0) throw std::invalid_argument{"Capacities must be positive."};
+        }
+        return capacities;
+    }
+
+    options ParseOptions(int argc, char** argv)
+    {
+        options opts;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const auto value = [&](const char* flag) -> const char* {
+                const std::string prefix = std::string{flag} + "=";
+                return arg.compare(0, prefix.size(), prefix) == 0 ? argv[i] + prefix.size() : nullptr;
+            };
+
+            if (const char* v = value("--format")) opts.format = v;
+            else if (const char* v = value("--capacity")) opts.capacities = ParseCapacities(v);
+            else if (const char* v = value("--policy")) opts.policy = v;
+            else if (const char* v = value("--backend")) opts.backend = v;
+            else if (!arg.empty() && arg[0] != '-' && opts.path.empty()) opts.path = arg;
+            else throw std::invalid_argument{"Unknown argument: " + arg};
+        }
+
+        if (opts.path.empty()) throw std::invalid_argument{"No trace file given."};
+        if (opts.capacities.empty()) opts.capacities.push_back(1000);
+        if (opts.format != "text" && opts.format != "lirs" && opts.format != "arc")
+        {
+            throw std::invalid_argument{"Unknown trace format: " + opts.format};
+        }
+        return opts;
+    }
+
+    std::vector<std::string> LoadTextTrace(std::istream& in)
+    {
+        std::vector<std::string> keys;
+        for (std::string line; std::getline(in, line);)
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) keys.push_back(std::move(line));
+        }
+        return keys;
+    }
+
+    // LIRS traces: a block number per line; other lines (markers) are skipped
+    std::vector<std::uint64_t> LoadLirsTrace(std::istream& in)
+    {
+        std::vector<std::uint64_t> blocks;
+        for (std::string line; std::getline(in, line);)
+        {
+            std::istringstream fields{line};
+            std::uint64_t block;
+            if (fields >> block) blocks.push_back(block);
+        }
+        return blocks;
+    }
+
+    // ARC traces: each request covers `count` consecutive blocks
+    std::vector<std::uint64_t> LoadArcTrace(std::istream& in)
+    {
+        std::vector<std::uint64_t> blocks;
+        for (std::string line; std::getline(in, line);)
+        {
+            std::istringstream fields{line};
+            std::uint64_t start, count;
+            if (!(fields >> start >> count)) continue;
+            for (std::uint64_t i = 0; i < count; ++i) blocks.push_back(start + i);
+        }
+        return blocks;
+    }
+
+    template <template <typename> class Policy, template <typename, typename> class Map, typename Key>
+    void ReplayOne(bench::policy_tag<Policy>, bench::backend_tag<Map>, const std::vector<Key>& keys,
+                   std::size_t capacity, const char* policy_name)
+    {
+        caches::fixed_sized_cache<Key, int, Policy, Map<Key, int>> cache{capacity};
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t hits = bench::Replay(cache, keys);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double hit_ratio = keys.empty() ? 0.0 : static_cast<double>(hits) / static_cast<double>(keys.size());
+        const double mops = elapsed.count() > 0 ? static_cast<double>(keys.size()) / elapsed.count() / 1e6 : 0.0;
+        std::printf("%-8s %12zu %10.4f %10.2f\n", policy_name, capacity, hit_ratio, mops);
+    }
+
+    template <typename Key>
+    void ReplayAll(const std::vector<Key>& keys, const options& opts)
+    {
+        std::printf("%zu requests, backend %s\n", keys.size(), opts.backend.c_str());
+        std::printf("%-8s %12s %10s %10s\n", "policy", "capacity", "hit_ratio", "Mops/s");
+
+        bool matched = false;
+        bench::ForEachBackend([&](auto backend, const char* backend_name) {
+            if (opts.backend != backend_name) return;
+            for (const std::size_t capacity : opts.capacities)
+            {
+                bench::ForEachPolicy([&](auto policy, const char* policy_name) {
+                    if (opts.policy != "all" && opts.policy != policy_name) return;
+                    matched = true;
+                    ReplayOne(policy, backend, keys, capacity, policy_name);
+                });
+            }
+        });
+
+        if (!matched) throw std::invalid_argument{"No policy/backend matches the options."};
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const options opts = ParseOptions(argc, argv);
+
+        std::ifstream in{opts.path};
+        if (!in) throw std::runtime_error{"Cannot open " + opts.path};
+
+        if (opts.format == "text") ReplayAll(LoadTextTrace(in), opts);
+        else if (opts.format == "lirs") ReplayAll(LoadLirsTrace(in), opts);
+        else ReplayAll(LoadArcTrace(in), opts);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "trace_replay: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#ifndef BENCH_WORKLOADS_HPP
+#define BENCH_WORKLOADS_HPP
+
+#include "arc_policy.hpp"
+#include "cache.hpp"
+#include "cache_policy.hpp"
+#include "clock_policy.hpp"
+#include "fifo_policy.hpp"
+#include "flat_hash_map.hpp"
+#include "lifo_policy.hpp"
+#include "lru_policy.hpp"
+#include "tinylfu_policy.hpp"
+#include "twoq_policy.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bench
+{
+    // HashMap backends, as templates over <Key, Value>
+    template <typename Key, typename Value>
+    using std_map = std::unordered_map<Key, Value>;
+
+    template <typename Key, typename Value>
+    using flat_map = caches::flat_hash_map<Key, Value>;
+
+    template <template <typename> class Policy>
+    struct policy_tag {};
+
+    template <template <typename, typename> class Map>
+    struct backend_tag {};
+
+    // Calls visit(policy_tag<P>{}, name) for every policy in the library
+    template <typename Visit>
+    void ForEachPolicy(Visit&& visit)
+    {
+        visit(policy_tag<caches::NoCachePolicy>{}, "None");
+        visit(policy_tag<caches::FIFOCachePolicy>{}, "FIFO");
+        visit(policy_tag<caches::LIFOCachePolicy>{}, "LIFO");
+        visit(policy_tag<caches::LRUCachePolicy>{}, "LRU");
+        visit(policy_tag<caches::ClockCachePolicy>{}, "CLOCK");
+        visit(policy_tag<caches::TinyLFUCachePolicy>{}, "TinyLFU");
+        visit(policy_tag<caches::ARCCachePolicy>{}, "ARC");
+        visit(policy_tag<caches::TwoQCachePolicy>{}, "2Q");
+    }
+
+    template <typename Visit>
+    void ForEachBackend(Visit&& visit)
+    {
+        visit(backend_tag<std_map>{}, "unordered_map");
+        visit(backend_tag<flat_map>{}, "flat_hash_map");
+    }
+
+    /*
+     * Zipf(s) over ids [0, n): id k is drawn with probability proportional
+     * to 1 / (k + 1)^s. Sampling is a binary search in the precomputed CDF.
+     */
+    class zipf_generator
+    {
+    public:
+        zipf_generator(std::size_t n, double s, std::uint64_t seed) : engine{seed}
+        {
+            cdf.reserve(n);
+            double sum = 0.0;
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                sum += 1.0 / std::pow(static_cast<double>(k + 1), s);
+                cdf.push_back(sum);
+            }
+            for (auto& p : cdf) p /= sum;
+        }
+
+        std::uint64_t operator()()
+        {
+            const double u = uniform(engine);
+            const auto it = std::lower_bound(cdf.begin(), cdf.end(), u);
+            return static_cast<std::uint64_t>(std::min<std::size_t>(it - cdf.begin(), cdf.size() - 1));
+        }
+
+    private:
+        std::vector<double> cdf;
+        std::mt19937_64 engine;
+        std::uniform_real_distribution<double> uniform{0.0, 1.0};
+    };
+
+    // Zipf-distributed id stream; ids are scrambled so hot keys aren't adjacent
+    inline std::vector<std::uint64_t> ZipfStream(std::size_t items, std::size_t length, double s = 0.99,
+                                                 std::uint64_t seed = 42)
+    {
+        zipf_generator zipf{items, s, seed};
+        std::vector<std::uint64_t> ids(length);
+        for (auto& id : ids) id = caches::mix_hash(zipf());
+        return ids;
+    }
+
+    /*
+     * Zipf traffic interrupted every `period` requests by a scan of
+     * `scan_length` keys that are never seen again: the pattern that flushes
+     * a plain LRU and that scan-resistant policies are meant to survive.
+     */
+    inline std::vector<std::uint64_t> ScanStream(std::size_t items, std::size_t length, std::size_t period,
+                                                 std::size_t scan_length, std::uint64_t seed = 42)
+    {
+        zipf_generator zipf{items, 0.99, seed};
+        std::vector<std::uint64_t> ids;
+        ids.reserve(length);
+        std::uint64_t next_cold = std::uint64_t{1} << 62;
+        while (ids.size() < length)
+        {
+            for (std::size_t i = 0; i < period && ids.size() < length; ++i)
+            {
+                ids.push_back(caches::mix_hash(zipf()));
+            }
+            for (std::size_t i = 0; i < scan_length && ids.size() < length; ++i)
+            {
+                ids.push_back(next_cold++);
+            }
+        }
+        return ids;
+    }
+
+    // Benchmarked key types: Make(id) builds the key for a workload id
+    struct int_keys
+    {
+        using type = int;
+        static int Make(std::uint64_t id) { return static_cast<int>(id ^ (id >> 32)); }
+    };
+
+    struct short_string_keys
+    {
+        using type = std::string;
+        static std::string Make(std::uint64_t id) { return std::to_string(id % 100000000); } // fits SSO
+    };
+
+    struct long_string_keys
+    {
+        using type = std::string;
+        static std::string Make(std::uint64_t id)
+        {
+            std::string key = "tenant-0042:session:user-profile:" + std::to_string(id);
+            key.resize(48, '#');
+            return key;
+        }
+    };
+
+    template <typename Keys>
+    struct key_tag {};
+
+    template <typename Visit>
+    void ForEachKeyType(Visit&& visit)
+    {
+        visit(key_tag<int_keys>{}, "int");
+        visit(key_tag<short_string_keys>{}, "short_string");
+        visit(key_tag<long_string_keys>{}, "long_string");
+    }
+
+    template <typename Keys>
+    std::vector<typename Keys::type> MakeKeys(const std::vector<std::uint64_t>& ids)
+    {
+        std::vector<typename Keys::type> keys;
+        keys.reserve(ids.size());
+        for (const auto id : ids) keys.push_back(Keys::Make(id));
+        return keys;
+    }
+
+    /*
+     * Replays keys as a read-through cache would: TryGet, and Put on a miss.
+     * Returns the number of hits.
+     */
+    template <typename Cache, typename Key>
+    std::size_t Replay(Cache& cache, const std::vector<Key>& keys)
+    {
+        std::size_t hits = 0;
+        for (const auto& key : keys)
+        {
+            if (cache.TryGet(key).second)
+            {
+                ++hits;
+            }
+            else
+            {
+                cache.Put(key, 0);
+            }
+        }
+        return hits;
+    }
+} // namespace bench
+
+#endif
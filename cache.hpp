@@ -2,47 +2,167 @@
 #define CACHE_HPP
 
 #include "cache_policy.hpp"
+#include "cache_stats.hpp"
+#include "hash_util.hpp"
+#include "weigher.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 namespace caches
 {
+    // Map supports C++17 node handles (extract / insert(node_type&&))
+    template <typename HashMap, typename = void>
+    struct has_node_handle : std::false_type {};
+
+    template <typename HashMap>
+    struct has_node_handle<HashMap, std::void_t<typename HashMap::node_type>> : std::true_type {};
+
+    // Map can be presized with reserve(n)
+    template <typename HashMap, typename = void>
+    struct has_reserve : std::false_type {};
+
+    template <typename HashMap>
+    struct has_reserve<HashMap, std::void_t<decltype(std::declval<HashMap&>().reserve(std::size_t{}))>>
+        : std::true_type {};
+
+    // Map reports the bytes it allocated itself (flat_hash_map::memory_usage)
+    template <typename HashMap, typename = void>
+    struct has_map_memory_usage : std::false_type {};
+
+    template <typename HashMap>
+    struct has_map_memory_usage<HashMap, std::void_t<decltype(std::declval<const HashMap&>().memory_usage())>>
+        : std::true_type {};
+
+    // HashMap supports lookups by K without converting to Key (transparent
+    // hasher and key equality, e.g. flat_hash_map with string_hash)
+    template <typename HashMap, typename K, typename = void>
+    struct is_transparent_lookup : std::false_type {};
+
+    template <typename HashMap, typename K>
+    struct is_transparent_lookup<HashMap, K, std::void_t<
+        typename HashMap::hasher::is_transparent,
+        typename HashMap::key_equal::is_transparent,
+        decltype(std::declval<const HashMap&>().find(std::declval<const K&>()))>>
+        : std::bool_constant<!std::is_same_v<std::decay_t<K>, typename HashMap::key_type>> {};
+
+    // HashMap can split a lookup into hash(key), prefetch(hash) and
+    // find(key, hash), as flat_hash_map does
+    template <typename HashMap, typename Key, typename = void>
+    struct has_hashed_lookup : std::false_type {};
+
+    template <typename HashMap, typename Key>
+    struct has_hashed_lookup<HashMap, Key, std::void_t<
+        decltype(std::declval<const HashMap&>().hash(std::declval<const Key&>())),
+        decltype(std::declval<const HashMap&>().prefetch(std::uint64_t{})),
+        decltype(std::declval<HashMap&>().find(std::declval<const Key&>(), std::uint64_t{}))>>
+        : std::true_type {};
+
+    // HashMap hashes Key exactly like key_hash and takes that hash for finds
+    // and inserts (flat_hash_map with std::hash), so one hash serves the
+    // cache's map and its policy
+    template <typename HashMap, typename Key, typename = void>
+    struct shares_key_hash : std::false_type {};
+
+    template <typename HashMap, typename Key>
+    struct shares_key_hash<HashMap, Key, std::void_t<
+        decltype(std::declval<HashMap&>().try_emplace_hashed(std::uint64_t{}, std::declval<const Key&>()))>>
+        : std::bool_constant<has_hashed_lookup<HashMap, Key>::value &&
+                             std::is_same_v<typename HashMap::hasher, std::hash<Key>>> {};
+
     /*
      * Fixed-size cache using a customizable eviction policy.
      * Key - Type of the key (must be hashable)
      * Value - Type of value
      * Policy - Eviction policy class template (like LRUCachePolicy, FIFOCachePolicy, etc.)
-     * HashMap - Map container (default: std::unordered_map)
+     * HashMap - Map container (default: std::unordered_map); must provide
+     *           find, try_emplace, erase(iterator) and iteration. Its
+     *           allocator also holds the values.
+     * Weigher - Cost of an entry, weigher(key, value) -> std::size_t. With the
+     *           default unit_weigher the capacity is an entry count; with any
+     *           other weigher it is a budget for the summed weights.
+     * Stats - Statistics hooks (see cache_stats.hpp); the default no_stats
+     *         compiles to nothing, cache_stats<> counts hits, misses,
+     *         inserts, updates and evictions
+     * OnErase - Callable invoked as on_erase(key, value) for every entry that
+     *           is evicted or removed. A callable that accepts Value&& gets
+     *           the value moved in (e.g. eviction_queue's sink); a stateless
+     *           no-op type compiles away entirely.
      */
     template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
-            typename HashMap = std::unordered_map<Key, Value>>
+            typename HashMap = std::unordered_map<Key, Value>, typename Weigher = unit_weigher,
+            typename Stats = no_stats, typename OnErase = std::function<void(const Key&, const Value&)>>
     class fixed_sized_cache
     {
+        static_assert(is_cache_policy<Policy<Key>, Key>::value,
+                      "Policy<Key> must provide Insert, Touch, Erase and ReplacementCandidate (see cache_policy.hpp).");
+
     public:
+        using key_type = Key;
+        using mapped_type = Value;
         using iterator = typename HashMap::iterator;
         using const_iterator = typename HashMap::const_iterator;
-        using on_erase_cb = typename std::function<void(const Key&, const Value&)>;
+        using on_erase_cb = OnErase;
+
+        // Capacity counts entries rather than weights
+        static constexpr bool counts_entries = std::is_same_v<Weigher, unit_weigher>;
+
+        // Each operation hashes its key once (key_hash) and hands the hash to
+        // whichever of the map and the policy can take it
+        static constexpr bool map_takes_hash = shares_key_hash<HashMap, Key>::value;
+        static constexpr bool policy_takes_hash = has_hashed_keys<Policy<Key>, Key>::value;
+
+        // Lookups are noexcept unless the Stats access hook may throw (mrc_stats
+        // allocates to record a sampled key)
+        static constexpr bool nothrow_lookups = nothrow_access_hook<Stats, Key>::value;
 
         /*
          * Constructor
-         * max_size - Maximum number of elements in the cache
+         * max_size - Maximum number of elements in the cache, or the maximum
+         *            total weight when a Weigher is used
          * policy - Eviction policy to be used
          * on_erase - Optional callback when an item is evicted
+         * weigher - Entry cost function
          */
         explicit fixed_sized_cache(
             size_t max_size,
             const Policy<Key>& policy = Policy<Key>{},
-            on_erase_cb on_erase = [](const Key&, const Value&) {})
+            on_erase_cb on_erase = DefaultOnErase(),
+            const Weigher& weigher = Weigher{})
             : cache_policy{policy},
               max_cache_size{max_size},
-              on_erase_callback{on_erase}
+              low_watermark{max_size},
+              on_erase_callback{on_erase},
+              entry_weigher{weigher}
         {
-            if (max_cache_size == 0)
-            {
-                throw std::invalid_argument{"Cache size must be greater than zero."};
-            }
+            Presize();
+        }
+
+        /*
+         * Constructor with the map's allocator, e.g. an arena shared with the
+         * policy: fixed_sized_cache<K, V, ArenaLRU, flat_hash_map<K, V, H, E,
+         * arena<...>>> cache{n, arena<...>{a}, ArenaLRU<K>{arena<K>{a}}}
+         */
+        template <typename Alloc, typename = std::enable_if_t<std::is_constructible_v<HashMap, const Alloc&>>>
+        fixed_sized_cache(
+            size_t max_size,
+            const Alloc& map_alloc,
+            const Policy<Key>& policy = Policy<Key>{},
+            on_erase_cb on_erase = DefaultOnErase(),
+            const Weigher& weigher = Weigher{})
+            : cache_items_map(map_alloc),
+              cache_policy{policy},
+              max_cache_size{max_size},
+              low_watermark{max_size},
+              on_erase_callback{on_erase},
+              entry_weigher{weigher}
+        {
+            Presize();
         }
 
         ~fixed_sized_cache() noexcept { Clear(); }
@@ -50,41 +170,136 @@ namespace caches
         // Adds or updates an entry
         void Put(const Key& key, const Value& value) noexcept
         {
-            auto element = cache_items_map.find(key);
+            Store(key, value);
+        }
 
-            if (element == cache_items_map.end())
-            {
-                if (cache_items_map.size() >= max_cache_size)
-                {
-                    const Key& evict_key = cache_policy.ReplacementCandidate();
-                    Erase(evict_key);
-                }
-                Insert(key, value);
-            }
-            else
+        // Put with hash == KeyHash(key) already computed
+        void Put(const Key& key, const Value& value, std::uint64_t hash) noexcept
+        {
+            StoreHashed(hash, key, value);
+        }
+
+        // Adds or updates an entry, moving the key and value into the cache
+        void Put(Key&& key, Value&& value) noexcept
+        {
+            Store(std::move(key), std::move(value));
+        }
+
+        // Adds or replaces the entry for key with a Value constructed from args
+        template <typename K, typename... Args>
+        void Emplace(K&& key, Args&&... args)
+        {
+            Store(std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+        // Constructs a Value from args only if key is absent; returns whether it did
+        template <typename K, typename... Args>
+        bool TryEmplace(K&& key, Args&&... args)
+        {
+            const std::uint64_t hash = HashFor(key);
+            if (MapFind(key, hash) != cache_items_map.end())
             {
-                Update(key, value);
+                return false;
             }
+            StoreNew(hash, std::forward<K>(key), std::forward<Args>(args)...);
+            return true;
         }
 
         // Try to get element by key; returns pair<iterator, found>
-        std::pair<const_iterator, bool> TryGet(const Key& key) noexcept
+        std::pair<const_iterator, bool> TryGet(const Key& key) noexcept(nothrow_lookups)
         {
-            auto element = cache_items_map.find(key);
+            return Lookup(key, HashFor(key));
+        }
 
-            if (element != cache_items_map.end())
+        /*
+         * TryGet with hash == KeyHash(key) already computed, e.g. by a caller
+         * that routed the key to a shard with it. The map and the policy then
+         * don't hash the key again, where they can take a hash.
+         */
+        std::pair<const_iterator, bool> TryGet(const Key& key, std::uint64_t hash) noexcept(nothrow_lookups)
+        {
+            return Lookup(key, hash);
+        }
+
+        // The hash the overloads taking one expect: key_hash(key)
+        static std::uint64_t KeyHash(const Key& key) noexcept(noexcept(key_hash(key)))
+        {
+            return key_hash(key);
+        }
+
+        // Heterogeneous lookup, e.g. by std::string_view on a std::string cache
+        template <typename K, typename = std::enable_if_t<is_transparent_lookup<HashMap, K>::value>>
+        std::pair<const_iterator, bool> TryGet(const K& key) noexcept
+        {
+            return Lookup(key);
+        }
+
+        /*
+         * Looks every key of [first, last) up like TryGet and writes one
+         * pair<const_iterator, bool> per key to out. Keys go in windows: the
+         * whole window is hashed and its map buckets (with flat_hash_map) and
+         * policy bookkeeping (with a Prefetch hint) are prefetched, then all
+         * lookups are resolved before any Touch, so the memory latency of a
+         * batch overlaps instead of being paid key by key.
+         */
+        template <typename ForwardIt, typename OutputIt>
+        OutputIt MultiGet(ForwardIt first, ForwardIt last, OutputIt out)
+        {
+            std::uint64_t hashes[batch_window];
+            iterator found[batch_window];
+            while (first != last)
             {
-                cache_policy.Touch(key);
-                return {element, true};
+                const std::size_t count = PrefetchWindow(first, last, hashes,
+                                                         [](const Key& key) -> const Key& { return key; });
+                ForwardIt it = first;
+                for (std::size_t i = 0; i < count; ++i, ++it)
+                {
+                    found[i] = FindHashed(*it, hashes[i]);
+                }
+                ForwardIt key = first;
+                for (std::size_t i = 0; i < count; ++i, ++first, ++key)
+                {
+                    RecordAccess(*key, BatchHash(*key, hashes[i]));
+                    *out++ = TouchFound(found[i], BatchHash(*key, hashes[i]));
+                }
             }
+            return out;
+        }
 
-            return {element, false};
+        // Puts every (key, value) pair of [first, last), prefetching like MultiGet
+        template <typename ForwardIt>
+        void MultiPut(ForwardIt first, ForwardIt last)
+        {
+            std::uint64_t hashes[batch_window];
+            while (first != last)
+            {
+                const std::size_t count = PrefetchWindow(first, last, hashes,
+                                                         [](const auto& entry) -> const Key& { return entry.first; });
+                for (std::size_t i = 0; i < count; ++i, ++first)
+                {
+                    const auto& entry = *first;
+                    StoreFound(FindHashed(entry.first, hashes[i]), BatchHash(entry.first, hashes[i]), entry.first,
+                               entry.second);
+                }
+            }
         }
 
         // Get value by key, throws if key not found
         const Value& Get(const Key& key)
         {
-            auto result = TryGet(key);
+            return CheckedGet(key, HashFor(key));
+        }
+
+        // Get with hash == KeyHash(key) already computed
+        const Value& Get(const Key& key, std::uint64_t hash)
+        {
+            return CheckedGet(key, hash);
+        }
+
+        template <typename K, typename = std::enable_if_t<is_transparent_lookup<HashMap, K>::value>>
+        const Value& Get(const K& key)
+        {
+            auto result = Lookup(key);
             if (!result.second)
             {
                 throw std::range_error("Key not found in cache.");
@@ -92,23 +307,175 @@ namespace caches
             return result.first->second;
         }
 
+        /*
+         * Returns the cached value for key, or on a miss stores and returns
+         * loader(key). If the loader throws nothing is stored and the
+         * exception propagates. Returns a copy because a weighted cache may
+         * not admit the loaded value.
+         */
+        template <typename Loader>
+        Value GetOrLoad(const Key& key, Loader&& loader)
+        {
+            const std::uint64_t hash = HashFor(key);
+            auto found = Lookup(key, hash);
+            if (found.second)
+            {
+                return found.first->second;
+            }
+
+            Value value = std::forward<Loader>(loader)(key);
+            StoreHashed(hash, key, value);
+            return value;
+        }
+
+        // Look up without counting as an access (the policy isn't touched)
+        std::pair<const_iterator, bool> Peek(const Key& key) const noexcept
+        {
+            auto element = cache_items_map.find(key);
+            return {element, element != cache_items_map.end()};
+        }
+
         // Check if a key exists
         bool Cached(const Key& key) const noexcept
         {
             return cache_items_map.find(key) != cache_items_map.end();
         }
 
+        // Cached with hash == KeyHash(key) already computed
+        bool Cached(const Key& key, std::uint64_t hash) const noexcept
+        {
+            return MapFind(key, hash) != cache_items_map.end();
+        }
+
+        template <typename K, typename = std::enable_if_t<is_transparent_lookup<HashMap, K>::value>>
+        bool Cached(const K& key) const noexcept
+        {
+            return cache_items_map.find(key) != cache_items_map.end();
+        }
+
         // Return number of entries
         std::size_t Size() const noexcept { return cache_items_map.size(); }
 
+        // Summed weight of all entries (equals Size() with unit_weigher)
+        std::size_t Weight() const noexcept { return current_weight; }
+
+        // Highest Weight() seen since construction
+        std::size_t PeakWeight() const noexcept { return peak_weight; }
+
+        // Capacity: entry count, or weight budget with a Weigher
+        std::size_t MaxSize() const noexcept { return max_cache_size; }
+
+        /*
+         * Batch reclamation: once an insert finds the cache full, it evicts
+         * down to `low` (entries or weight, including the new entry) in one
+         * pass, so the following inserts don't each pay for an eviction.
+         * The default, low == MaxSize(), evicts just enough for the new entry.
+         */
+        void SetLowWatermark(std::size_t low)
+        {
+            if (low > max_cache_size)
+            {
+                throw std::invalid_argument{"Low watermark must not exceed the cache size."};
+            }
+            low_watermark = low;
+        }
+
+        std::size_t LowWatermark() const noexcept { return low_watermark; }
+
+        /*
+         * Changes the capacity at runtime; shrinking evicts replacement
+         * candidates (calling on_erase) until the cache fits. A low watermark
+         * equal to the old capacity follows it, a lower one is kept but
+         * capped at the new capacity.
+         *
+         * Policies with a Reserve hint are resized too: W-TinyLFU's window and
+         * protected segments, ARC's target and ghost lists and 2Q's A1in and
+         * A1out follow the new entry count before anything is evicted. Under
+         * a Weigher they are re-seeded from the resident count afterwards.
+         * LRU, FIFO, LIFO and CLOCK have no capacity-derived state.
+         */
+        void Resize(std::size_t new_size)
+        {
+            if (new_size == 0)
+            {
+                throw std::invalid_argument{"Cache size must be greater than zero."};
+            }
+            if constexpr (counts_entries && has_reserve_hint<Policy<Key>>::value)
+            {
+                cache_policy.Reserve(new_size);
+            }
+            low_watermark = low_watermark == max_cache_size ? new_size : std::min(low_watermark, new_size);
+            max_cache_size = new_size;
+            EvictDownTo(max_cache_size);
+            if constexpr (!counts_entries && has_reserve_hint<Policy<Key>>::value)
+            {
+                cache_policy.Reserve(cache_items_map.size());
+            }
+        }
+
+        // Hands deferred evictions to the erase callback, when it queues them
+        // (see eviction_queue); returns how many were delivered
+        template <typename C = on_erase_cb>
+        auto DrainEvictions() -> decltype(std::declval<C&>().Drain())
+        {
+            return on_erase_callback.Drain();
+        }
+
+        // Statistics collected so far (e.g. Statistics().Snapshot() with cache_stats)
+        const Stats& Statistics() const noexcept { return stats; }
+
+        // Mutable access, e.g. to configure mrc_stats estimators
+        Stats& Statistics() noexcept { return stats; }
+
+        /*
+         * Approximate bytes held, by table, policy metadata, keys and values.
+         * Keys and values are their estimated_size (inline part included);
+         * the table is what the map adds on top. Walks every entry.
+         */
+        memory_usage MemoryUsage() const
+        {
+            memory_usage usage;
+            for (const auto& entry : cache_items_map)
+            {
+                usage.keys += estimated_size(entry.first);
+                usage.values += estimated_size(entry.second);
+            }
+
+            const std::size_t entries = cache_items_map.size();
+            if constexpr (has_map_memory_usage<HashMap>::value)
+            {
+                usage.table = cache_items_map.memory_usage() - entries * sizeof(typename HashMap::value_type);
+            }
+            else
+            {
+                // Node-based map: a bucket pointer per bucket, and per node a
+                // next pointer and the cached hash
+                usage.table = cache_items_map.bucket_count() * sizeof(void*) +
+                              entries * (sizeof(void*) + sizeof(std::size_t));
+            }
+
+            if constexpr (has_memory_usage<Policy<Key>>::value) usage.policy = cache_policy.MemoryUsage();
+            return usage;
+        }
+
         // Remove a key, return true if it existed
         bool Remove(const Key& key)
         {
-            auto it = cache_items_map.find(key);
-            if (it == cache_items_map.end()) return false;
+            const std::uint64_t hash = HashFor(key);
+            return RemoveFound(MapFind(key, hash), hash);
+        }
 
-            Erase(it);
-            return true;
+        // Remove with hash == KeyHash(key) already computed
+        bool Remove(const Key& key, std::uint64_t hash)
+        {
+            return RemoveFound(MapFind(key, hash), hash);
+        }
+
+        template <typename K, typename = std::enable_if_t<is_transparent_lookup<HashMap, K>::value>>
+        bool Remove(const K& key)
+        {
+            auto element = cache_items_map.find(key);
+            return RemoveFound(element, element == cache_items_map.end() ? 0 : HashFor(element->first));
         }
 
         // Remove everything
@@ -119,44 +486,504 @@ namespace caches
                 cache_policy.Erase(key);
             }
             cache_items_map.clear();
+            current_weight = 0;
+        }
+
+        /*
+         * Visits every entry as visit(key, value) without touching the
+         * policy. Policies with ordered keys (LRU, FIFO, LIFO) are walked
+         * oldest first, so putting the entries into an empty cache in the
+         * same order restores their order; otherwise map order is used.
+         */
+        template <typename Visit>
+        void ForEach(Visit&& visit) const
+        {
+            if constexpr (has_ordered_keys<Policy<Key>, Key>::value)
+            {
+                cache_policy.ForEach([&](const Key& key) {
+                    const auto element = cache_items_map.find(key);
+                    visit(element->first, element->second);
+                });
+            }
+            else
+            {
+                for (const auto& [key, value] : cache_items_map)
+                {
+                    visit(key, value);
+                }
+            }
         }
 
         const_iterator begin() const noexcept { return cache_items_map.cbegin(); }
         const_iterator end() const noexcept { return cache_items_map.cend(); }
 
     private:
-        void Insert(const Key& key, const Value& value)
+        // std::function's default is empty, so it gets a no-op in its place
+        static on_erase_cb DefaultOnErase()
         {
-            cache_policy.Insert(key);
-            cache_items_map.emplace(key, value);
+            if constexpr (std::is_same_v<on_erase_cb, std::function<void(const Key&, const Value&)>>)
+            {
+                return [](const Key&, const Value&) {};
+            }
+            else
+            {
+                return on_erase_cb{};
+            }
         }
 
-        void Update(const Key& key, const Value& value)
+        // The entry is destroyed or overwritten right after, so a callback
+        // taking Value&& may steal the value
+        void NotifyErase(const Key& key, Value& value)
         {
-            cache_policy.Touch(key);
-            cache_items_map[key] = value;
+            if constexpr (std::is_invocable_v<on_erase_cb&, const Key&, Value&&>)
+            {
+                on_erase_callback(key, std::move(value));
+            }
+            else
+            {
+                on_erase_callback(key, static_cast<const Value&>(value));
+            }
         }
 
-        void Erase(const_iterator it)
+        // Keys hashed and prefetched ahead of the first probe by MultiGet/MultiPut
+        static constexpr std::size_t batch_window = 16;
+
+        // Hashes up to batch_window entries from first and prefetches what
+        // their lookups will read; returns how many it took
+        template <typename ForwardIt, typename KeyOf>
+        std::size_t PrefetchWindow(ForwardIt first, ForwardIt last, std::uint64_t (&hashes)[batch_window],
+                                   KeyOf key_of) const noexcept
         {
-            cache_policy.Erase(it->first);
-            on_erase_callback(it->first, it->second);
-            cache_items_map.erase(it);
+            std::size_t count = 0;
+            for (; first != last && count < batch_window; ++first, ++count)
+            {
+                const Key& key = key_of(*first);
+                if constexpr (has_hashed_lookup<HashMap, Key>::value)
+                {
+                    hashes[count] = cache_items_map.hash(key);
+                    cache_items_map.prefetch(hashes[count]);
+                }
+                else
+                {
+                    hashes[count] = 0;
+                }
+                if constexpr (has_prefetch_hint<Policy<Key>, Key>::value)
+                {
+                    cache_policy.Prefetch(key);
+                }
+            }
+            return count;
+        }
+
+        // key_hash(key) when the map or the policy can use it, else 0 (unused)
+        template <typename K>
+        static std::uint64_t HashFor(const K& key) noexcept
+        {
+            if constexpr (map_takes_hash || policy_takes_hash)
+            {
+                return key_hash<Key>(key);
+            }
+            else
+            {
+                (void)key;
+                return 0;
+            }
+        }
+
+        // Policy hash for a key of a batch whose map hash is `hash`
+        static std::uint64_t BatchHash(const Key& key, std::uint64_t hash) noexcept
+        {
+            if constexpr (map_takes_hash) return hash;
+            else return HashFor(key);
+        }
+
+        template <typename K>
+        iterator MapFind(const K& key, std::uint64_t hash) noexcept
+        {
+            if constexpr (map_takes_hash && std::is_same_v<K, Key>)
+            {
+                return cache_items_map.find(key, hash);
+            }
+            else
+            {
+                (void)hash;
+                return cache_items_map.find(key);
+            }
+        }
+
+        const_iterator MapFind(const Key& key, std::uint64_t hash) const noexcept
+        {
+            if constexpr (map_takes_hash)
+            {
+                return cache_items_map.find(key, hash);
+            }
+            else
+            {
+                (void)hash;
+                return cache_items_map.find(key);
+            }
+        }
+
+        template <typename K, typename... Args>
+        iterator MapEmplace(std::uint64_t hash, K&& key, Args&&... args)
+        {
+            if constexpr (map_takes_hash)
+            {
+                return cache_items_map.try_emplace_hashed(hash, std::forward<K>(key), std::forward<Args>(args)...).first;
+            }
+            else
+            {
+                (void)hash;
+                return cache_items_map.try_emplace(std::forward<K>(key), std::forward<Args>(args)...).first;
+            }
+        }
+
+        void PolicyInsert(const Key& key, std::uint64_t hash)
+        {
+            if constexpr (policy_takes_hash) cache_policy.Insert(key, hash);
+            else cache_policy.Insert(key);
+        }
+
+        void PolicyTouch(const Key& key, std::uint64_t hash)
+        {
+            if constexpr (policy_takes_hash) cache_policy.Touch(key, hash);
+            else cache_policy.Touch(key);
+        }
+
+        void PolicyErase(const Key& key, std::uint64_t hash)
+        {
+            if constexpr (policy_takes_hash) cache_policy.Erase(key, hash);
+            else cache_policy.Erase(key);
+        }
+
+        // find with a hash from PrefetchWindow, when the map takes one
+        iterator FindHashed(const Key& key, std::uint64_t hash) noexcept
+        {
+            if constexpr (has_hashed_lookup<HashMap, Key>::value)
+            {
+                return cache_items_map.find(key, hash);
+            }
+            else
+            {
+                (void)hash;
+                return cache_items_map.find(key);
+            }
+        }
+
+        // The access is recorded before anything changes, so a throwing
+        // hook leaves the cache as it was
+        std::pair<const_iterator, bool> Lookup(const Key& key, std::uint64_t hash) noexcept(nothrow_lookups)
+        {
+            const auto timer = stats.StartTimer();
+            RecordAccess(key, hash);
+            auto result = TouchFound(MapFind(key, hash), hash);
+            stats.StopGet(timer);
+            return result;
+        }
+
+        // Hands the key to the Stats access hook, with its key_hash
+        void RecordAccess(const Key& key, std::uint64_t hash) noexcept(nothrow_lookups)
+        {
+            if constexpr (has_access_hook<Stats, Key>::value)
+            {
+                stats.OnAccess(key, map_takes_hash || policy_takes_hash ? hash : key_hash(key));
+            }
+            else
+            {
+                (void)key;
+                (void)hash;
+            }
+        }
+
+        // Heterogeneous lookup: the hash is taken from the key found
+        template <typename K>
+        std::pair<const_iterator, bool> Lookup(const K& key) noexcept
+        {
+            const auto timer = stats.StartTimer();
+            auto element = cache_items_map.find(key);
+            auto result = TouchFound(element, element == cache_items_map.end() ? 0 : HashFor(element->first));
+            stats.StopGet(timer);
+            return result;
+        }
+
+        std::pair<const_iterator, bool> TouchFound(iterator element, std::uint64_t hash) noexcept
+        {
+            if (element != cache_items_map.end())
+            {
+                PolicyTouch(element->first, hash);
+                stats.OnHit();
+                return {element, true};
+            }
+
+            stats.OnMiss();
+            return {element, false};
+        }
+
+        const Value& CheckedGet(const Key& key, std::uint64_t hash)
+        {
+            auto result = Lookup(key, hash);
+            if (!result.second)
+            {
+                throw std::range_error("Key not found in cache.");
+            }
+            return result.first->second;
+        }
+
+        bool RemoveFound(iterator it, std::uint64_t hash)
+        {
+            if (it == cache_items_map.end()) return false;
+
+            Erase(it, hash);
+            return true;
+        }
+
+        // Insert or update; args construct (or are assigned to) the value
+        template <typename K, typename... Args>
+        void Store(K&& key, Args&&... args)
+        {
+            const std::uint64_t hash = HashFor(key);
+            StoreHashed(hash, std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+        template <typename K, typename... Args>
+        void StoreHashed(std::uint64_t hash, K&& key, Args&&... args)
+        {
+            const auto timer = stats.StartTimer();
+            StoreFound(MapFind(key, hash), hash, std::forward<K>(key), std::forward<Args>(args)...);
+            stats.StopPut(timer);
+        }
+
+        // Store with the result of looking key up already in hand
+        template <typename K, typename... Args>
+        void StoreFound(iterator element, std::uint64_t hash, K&& key, Args&&... args)
+        {
+            if (element == cache_items_map.end())
+            {
+                StoreNew(hash, std::forward<K>(key), std::forward<Args>(args)...);
+            }
+            else
+            {
+                Update(element, hash, std::forward<Args>(args)...);
+            }
+        }
+
+        // Insert a key known to be absent, evicting first when full
+        template <typename K, typename... Args>
+        void StoreNew(std::uint64_t hash, K&& key, Args&&... args)
+        {
+            if constexpr (!counts_entries)
+            {
+                StoreWeighted(hash, std::forward<K>(key), std::forward<Args>(args)...);
+                return;
+            }
+
+            if (cache_items_map.size() >= max_cache_size)
+            {
+                // Room for exactly one: swap the victim for the new entry
+                if (low_watermark >= max_cache_size)
+                {
+                    const Key& evict_key = cache_policy.ReplacementCandidate();
+                    const std::uint64_t evict_hash = HashFor(evict_key);
+                    Replace(MapFind(evict_key, evict_hash), evict_hash, hash, std::forward<K>(key),
+                            std::forward<Args>(args)...);
+                    return;
+                }
+                // Leave room for the new entry within the watermark
+                EvictDownTo(low_watermark > 0 ? low_watermark - 1 : 0);
+            }
+            Insert(hash, std::forward<K>(key), std::forward<Args>(args)...);
         }
 
-        void Erase(const Key& key)
+        // The weight is only known once the value exists: build the entry,
+        // then evict others until it fits, and only then tell the policy
+        // about it so it can't be picked as its own victim
+        template <typename K, typename... Args>
+        void StoreWeighted(std::uint64_t hash, K&& key, Args&&... args)
         {
-            auto it = cache_items_map.find(key);
-            if (it != cache_items_map.end())
+            auto element = MapEmplace(hash, std::forward<K>(key), std::forward<Args>(args)...);
+            const std::size_t weight = entry_weigher(element->first, element->second);
+
+            // Larger than the whole budget: never admitted
+            if (weight > max_cache_size)
             {
-                Erase(it);
+                cache_items_map.erase(element);
+                return;
             }
+
+            if (current_weight + weight > max_cache_size)
+            {
+                EvictDownTo((weight <= low_watermark ? low_watermark : max_cache_size) - weight);
+            }
+
+            PolicyInsert(element->first, hash);
+            stats.OnInsert();
+            AddWeight(weight);
+        }
+
+        // The key is moved into the map once; the policy copies it from there
+        template <typename K, typename... Args>
+        void Insert(std::uint64_t hash, K&& key, Args&&... args)
+        {
+            auto element = MapEmplace(hash, std::forward<K>(key), std::forward<Args>(args)...);
+            PolicyInsert(element->first, hash);
+            stats.OnInsert();
+            AddWeight(entry_weigher(element->first, element->second));
+        }
+
+        // Evict `victim` and store key/value in its place, reusing the victim's
+        // map node when the map allows it so a full cache doesn't allocate
+        template <typename K, typename... Args>
+        void Replace(iterator victim, std::uint64_t victim_hash, std::uint64_t hash, K&& key, Args&&... args)
+        {
+            stats.OnEviction();
+            if constexpr (has_node_handle<HashMap>::value)
+            {
+                PolicyErase(victim->first, victim_hash);
+                NotifyErase(victim->first, victim->second);
+
+                auto node = cache_items_map.extract(victim);
+                node.key() = std::forward<K>(key);
+                AssignValue(node.mapped(), std::forward<Args>(args)...);
+                auto element = cache_items_map.insert(std::move(node)).position;
+                PolicyInsert(element->first, hash);
+                stats.OnInsert();
+                // unit weight: one entry out, one in
+            }
+            else
+            {
+                Erase(victim, victim_hash);
+                Insert(hash, std::forward<K>(key), std::forward<Args>(args)...);
+            }
+        }
+
+        template <typename... Args>
+        void Update(iterator element, std::uint64_t hash, Args&&... args)
+        {
+            PolicyTouch(element->first, hash);
+            stats.OnUpdate();
+
+            if constexpr (counts_entries)
+            {
+                AssignValue(element->second, std::forward<Args>(args)...);
+            }
+            else
+            {
+                const std::size_t old_weight = entry_weigher(element->first, element->second);
+                AssignValue(element->second, std::forward<Args>(args)...);
+                const std::size_t new_weight = entry_weigher(element->first, element->second);
+
+                if (new_weight > max_cache_size)
+                {
+                    current_weight += new_weight - old_weight;
+                    Erase(element, hash);
+                    stats.OnEviction();
+                    return;
+                }
+
+                current_weight = current_weight - old_weight + new_weight;
+
+                // Make room at the expense of other entries, until the policy
+                // picks the entry that just grew: then it goes instead. The
+                // candidate is read once per pass, since asking may move the
+                // policy on (CLOCK's hand).
+                while (current_weight > max_cache_size)
+                {
+                    const Key& candidate = cache_policy.ReplacementCandidate();
+                    if (candidate == element->first)
+                    {
+                        Erase(element, hash);
+                        stats.OnEviction();
+                        return;
+                    }
+                    Evict(candidate);
+                }
+                AddWeight(0);
+            }
+        }
+
+        void Presize()
+        {
+            if (max_cache_size == 0)
+            {
+                throw std::invalid_argument{"Cache size must be greater than zero."};
+            }
+
+            // The cache never grows past max_cache_size entries, so size
+            // everything once. A weight budget says nothing about the count.
+            if constexpr (counts_entries && has_reserve_hint<Policy<Key>>::value)
+            {
+                cache_policy.Reserve(max_cache_size);
+            }
+            if constexpr (counts_entries && has_reserve<HashMap>::value)
+            {
+                cache_items_map.reserve(max_cache_size);
+            }
+        }
+
+        // Entries, or weight with a Weigher, that count against max_cache_size
+        std::size_t Occupancy() const noexcept
+        {
+            if constexpr (counts_entries) return cache_items_map.size();
+            else return current_weight;
+        }
+
+        // Evicts replacement candidates until Occupancy() <= limit
+        void EvictDownTo(std::size_t limit)
+        {
+            while (Occupancy() > limit)
+            {
+                EvictCandidate();
+            }
+        }
+
+        void EvictCandidate() { Evict(cache_policy.ReplacementCandidate()); }
+
+        // Evicts the entry of a key the policy just named as its candidate
+        void Evict(const Key& candidate)
+        {
+            const std::uint64_t hash = HashFor(candidate);
+            Erase(MapFind(candidate, hash), hash);
+            stats.OnEviction();
+        }
+
+        void AddWeight(std::size_t weight) noexcept
+        {
+            current_weight += weight;
+            if (current_weight > peak_weight) peak_weight = current_weight;
+        }
+
+        // Assigns directly when given a single assignable argument, so
+        // Put(key, value) doesn't build a temporary Value
+        template <typename... Args>
+        static void AssignValue(Value& target, Args&&... args)
+        {
+            if constexpr (sizeof...(Args) == 1 && (std::is_assignable_v<Value&, Args&&> && ...))
+            {
+                (static_cast<void>(target = std::forward<Args>(args)), ...);
+            }
+            else
+            {
+                target = Value(std::forward<Args>(args)...);
+            }
+        }
+
+        void Erase(iterator it, std::uint64_t hash)
+        {
+            PolicyErase(it->first, hash);
+            current_weight -= entry_weigher(it->first, it->second);
+            NotifyErase(it->first, it->second);
+            cache_items_map.erase(it);
         }
 
         HashMap cache_items_map;
         Policy<Key> cache_policy;
         std::size_t max_cache_size;
+        std::size_t low_watermark; // reclaim target once full, see SetLowWatermark
         on_erase_cb on_erase_callback;
+        Weigher entry_weigher;
+        Stats stats;
+        std::size_t current_weight = 0;
+        std::size_t peak_weight = 0;
     };
 } // namespace caches
 
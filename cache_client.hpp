@@ -0,0 +1,555 @@
+#ifndef CACHE_CLIENT_HPP
+#define CACHE_CLIENT_HPP
+
+#include "cache_protocol.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace caches
+{
+    /*
+     * Blocking connection to one cache_server. The Send* calls only queue a
+     * request and return its id; Flush writes everything queued in one go
+     * and Receive reads the responses, so any number of requests can be in
+     * flight (pipelining). Receive(id) waits for one request's response and
+     * keeps the earlier ones for later. Get / Put / Remove and the Multi*
+     * calls do all three for a single request, and so mix freely with
+     * hand-pipelined requests.
+     * Throws std::system_error on socket errors and protocol::protocol_error
+     * on a malformed response. Either breaks the connection: every later
+     * call throws std::logic_error (see Broken()).
+     */
+    class cache_connection
+    {
+    public:
+        // Result of one request: per key a value (get), nothing (put) or
+        // whether it was removed (remove)
+        struct response
+        {
+            std::uint32_t request_id = 0;
+            protocol::status code = protocol::status::ok;
+            std::vector<std::optional<std::string>> values;
+            std::vector<bool> removed;
+        };
+
+        cache_connection(const std::string& host, std::uint16_t port) : fd{Connect(host, port)} {}
+
+        cache_connection(cache_connection&& other) noexcept
+            : fd{std::exchange(other.fd, -1)},
+              next_id{other.next_id},
+              out{std::move(other.out)},
+              in{std::move(other.in)},
+              in_flight{std::move(other.in_flight)},
+              received{std::move(other.received)},
+              broken{other.broken}
+        {
+        }
+
+        cache_connection& operator=(cache_connection&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (fd >= 0) ::close(fd);
+                fd = std::exchange(other.fd, -1);
+                next_id = other.next_id;
+                out = std::move(other.out);
+                in = std::move(other.in);
+                in_flight = std::move(other.in_flight);
+                received = std::move(other.received);
+                broken = other.broken;
+            }
+            return *this;
+        }
+
+        ~cache_connection()
+        {
+            if (fd >= 0) ::close(fd);
+        }
+
+        // The Send* calls throw protocol::protocol_error for a request
+        // past max_frame_size, leaving the connection usable
+        std::uint32_t SendGet(const std::vector<std::string>& keys)
+        {
+            return Queue(protocol::opcode::get, keys.size(), [&] { protocol::WriteGet(out, next_id, keys); });
+        }
+
+        std::uint32_t SendPut(const std::vector<std::pair<std::string, std::string>>& entries)
+        {
+            return Queue(protocol::opcode::put, 0, [&] { protocol::WritePut(out, next_id, entries); });
+        }
+
+        std::uint32_t SendRemove(const std::vector<std::string>& keys)
+        {
+            return Queue(protocol::opcode::remove, keys.size(), [&] { protocol::WriteRemove(out, next_id, keys); });
+        }
+
+        /*
+         * Writes every queued request. Responses that arrive meanwhile are
+         * read into the input buffer, so a long pipeline can't deadlock with
+         * a server that stops reading until its answers are taken.
+         */
+        void Flush()
+        {
+            CheckUsable();
+            BreakOnError([&] { Send(); });
+        }
+
+        // Oldest response not received yet; flushes first if needed
+        response Receive()
+        {
+            CheckUsable();
+            if (!received.empty())
+            {
+                response result = std::move(received.front());
+                received.pop_front();
+                return result;
+            }
+            if (in_flight.empty()) throw std::logic_error{"No request in flight."};
+            return BreakOnError([&] { return ReadNext(); });
+        }
+
+        // Response to request_id. Responses to earlier requests that arrive
+        // first are kept for Receive.
+        response Receive(std::uint32_t request_id)
+        {
+            CheckUsable();
+            const auto ready = std::find_if(received.begin(), received.end(),
+                                            [&](const response& r) { return r.request_id == request_id; });
+            if (ready != received.end())
+            {
+                response result = std::move(*ready);
+                received.erase(ready);
+                return result;
+            }
+            if (std::none_of(in_flight.begin(), in_flight.end(), [&](const pending& p) { return p.id == request_id; }))
+            {
+                throw std::logic_error{"Request not in flight."};
+            }
+
+            return BreakOnError([&] {
+                for (;;)
+                {
+                    response result = ReadNext();
+                    if (result.request_id == request_id) return result;
+                    received.push_back(std::move(result));
+                }
+            });
+        }
+
+        std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys)
+        {
+            return Checked(Receive(SendGet(keys))).values;
+        }
+
+        void MultiPut(const std::vector<std::pair<std::string, std::string>>& entries)
+        {
+            Checked(Receive(SendPut(entries)));
+        }
+
+        std::optional<std::string> Get(const std::string& key) { return std::move(MultiGet({key}).front()); }
+        void Put(const std::string& key, const std::string& value) { MultiPut({{key, value}}); }
+
+        bool Remove(const std::string& key) { return Checked(Receive(SendRemove({key}))).removed.front(); }
+
+        // Requests whose response hasn't been returned by Receive yet
+        std::size_t InFlight() const noexcept { return in_flight.size() + received.size(); }
+
+        // Whether a socket or protocol error made the connection unusable
+        bool Broken() const noexcept { return broken; }
+
+        // Passes an ok response through, throws for a rejected request
+        static response Checked(response result)
+        {
+            if (result.code == protocol::status::too_large)
+            {
+                throw std::runtime_error{"Cache server response too large for one frame."};
+            }
+            if (result.code != protocol::status::ok) throw std::runtime_error{"Cache server rejected the request."};
+            return result;
+        }
+
+    private:
+        void CheckUsable() const
+        {
+            if (broken) throw std::logic_error{"Cache connection is broken."};
+        }
+
+        template <typename F>
+        auto BreakOnError(F f) -> decltype(f())
+        {
+            try
+            {
+                return f();
+            }
+            catch (...)
+            {
+                broken = true;
+                throw;
+            }
+        }
+
+        void Send()
+        {
+            std::size_t sent = 0;
+            while (sent < out.size())
+            {
+                pollfd ready{fd, POLLIN | POLLOUT, 0};
+                if (::poll(&ready, 1, -1) < 0)
+                {
+                    if (errno == EINTR) continue;
+                    throw std::system_error{errno, std::generic_category(), "Cannot poll cache server"};
+                }
+                if (ready.revents & POLLIN) Fill();
+                if (!(ready.revents & (POLLOUT | POLLERR | POLLHUP))) continue;
+
+                const ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+                if (n < 0) throw std::system_error{errno, std::generic_category(), "Cannot send to cache server"};
+                sent += static_cast<std::size_t>(n);
+            }
+            out.clear();
+        }
+
+        static int Connect(const std::string& host, std::uint16_t port)
+        {
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* found = nullptr;
+            const int rc = ::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found);
+            if (rc != 0) throw std::runtime_error{"Cannot resolve " + host + ": " + ::gai_strerror(rc)};
+            const std::unique_ptr<addrinfo, decltype(&::freeaddrinfo)> addresses{found, &::freeaddrinfo};
+
+            int error = 0;
+            for (const addrinfo* a = found; a != nullptr; a = a->ai_next)
+            {
+                const int fd = ::socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+                if (fd < 0)
+                {
+                    error = errno;
+                    continue;
+                }
+                if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+                {
+                    const int on = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                    return fd;
+                }
+                error = errno;
+                ::close(fd);
+            }
+            throw std::system_error{error, std::generic_category(),
+                                    "Cannot connect to " + host + ":" + std::to_string(port)};
+        }
+
+        // Reads and parses the response to the oldest request in flight
+        response ReadNext()
+        {
+            if (!out.empty()) Send();
+
+            std::optional<protocol::frame_header> header;
+            while (!(header = protocol::PeekFrame(in))) Fill();
+
+            const pending request = in_flight.front();
+            if (header->request_id != request.id) throw protocol::protocol_error{"Response out of order."};
+            in_flight.pop_front();
+
+            response result;
+            result.request_id = request.id;
+            result.code = static_cast<protocol::status>(header->code);
+            protocol::frame_reader body{std::string_view{in}.substr(protocol::header_size, header->length)};
+            if (result.code == protocol::status::ok)
+            {
+                if (request.op == protocol::opcode::get)
+                {
+                    const std::uint32_t count = Count(body, request);
+                    result.values.reserve(count);
+                    for (std::uint32_t i = 0; i < count; ++i)
+                    {
+                        if (body.U8() != 0) result.values.emplace_back(std::string{body.Bytes()});
+                        else result.values.emplace_back();
+                    }
+                }
+                else if (request.op == protocol::opcode::remove)
+                {
+                    const std::uint32_t count = Count(body, request);
+                    for (std::uint32_t i = 0; i < count; ++i) result.removed.push_back(body.U8() != 0);
+                }
+                if (!body.Done()) throw protocol::protocol_error{"Trailing bytes in response."};
+            }
+            in.erase(0, protocol::header_size + header->length);
+            return result;
+        }
+
+        struct pending
+        {
+            std::uint32_t id;
+            protocol::opcode op;
+            std::size_t keys;
+        };
+
+        // Appends a request frame, dropping what it wrote if it throws
+        template <typename Write>
+        std::uint32_t Queue(protocol::opcode op, std::size_t keys, Write write)
+        {
+            CheckUsable();
+            const std::size_t mark = out.size();
+            try
+            {
+                write();
+                in_flight.push_back({next_id, op, keys});
+            }
+            catch (...)
+            {
+                out.resize(mark);
+                throw;
+            }
+            return next_id++;
+        }
+
+        // Item count of a response, which must answer every key of the request
+        static std::uint32_t Count(protocol::frame_reader& body, const pending& request)
+        {
+            const std::uint32_t count = body.Count(1);
+            if (count != request.keys) throw protocol::protocol_error{"Response doesn't match the request."};
+            return count;
+        }
+
+        void Fill()
+        {
+            char buffer[64 * 1024];
+            for (;;)
+            {
+                const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+                if (n > 0)
+                {
+                    in.append(buffer, static_cast<std::size_t>(n));
+                    return;
+                }
+                if (n < 0 && errno == EINTR) continue;
+                if (n == 0) throw std::system_error{ECONNRESET, std::generic_category(), "Cache server closed the connection"};
+                throw std::system_error{errno, std::generic_category(), "Cannot receive from cache server"};
+            }
+        }
+
+        int fd;
+        std::uint32_t next_id = 1;
+        std::string out;
+        std::string in;
+        std::deque<pending> in_flight;
+        std::deque<response> received; // read ahead by Receive(id)
+        bool broken = false;
+    };
+
+    /*
+     * Consistent-hash ring with virtual nodes: each node owns `replicas`
+     * points on a 64-bit ring (protocol::RoutingHash of "name#i") and a key
+     * belongs to the node of the first point at or after its hash. Adding
+     * or removing a node moves only about 1/n of the keys, and the virtual
+     * nodes keep the shares even.
+     */
+    class consistent_hash_ring
+    {
+    public:
+        static constexpr std::size_t default_replicas = 160;
+
+        // Returns the index of the node, in the order of adding
+        std::size_t AddNode(const std::string& name, std::size_t replicas = default_replicas)
+        {
+            if (std::find(names.begin(), names.end(), name) != names.end())
+            {
+                throw std::invalid_argument{"Node already on the ring: " + name};
+            }
+            const std::size_t node = names.size();
+            names.push_back(name);
+            for (std::size_t i = 0; i < replicas; ++i)
+            {
+                points.emplace_back(protocol::RoutingHash(name + "#" + std::to_string(i)), node);
+            }
+            std::sort(points.begin(), points.end());
+            return node;
+        }
+
+        // Takes the node's points off the ring; its index stays reserved
+        void RemoveNode(const std::string& name)
+        {
+            const auto found = std::find(names.begin(), names.end(), name);
+            if (found == names.end()) return;
+            const std::size_t node = static_cast<std::size_t>(found - names.begin());
+            points.erase(std::remove_if(points.begin(), points.end(), [&](const auto& p) { return p.second == node; }),
+                         points.end());
+        }
+
+        // Index of the node owning key
+        std::size_t NodeFor(std::string_view key) const
+        {
+            if (points.empty()) throw std::logic_error{"Consistent-hash ring has no nodes."};
+            const std::uint64_t hash = protocol::RoutingHash(key);
+            auto it = std::lower_bound(points.begin(), points.end(), std::make_pair(hash, std::size_t{0}));
+            if (it == points.end()) it = points.begin();
+            return it->second;
+        }
+
+        const std::string& Name(std::size_t node) const { return names.at(node); }
+        std::size_t Nodes() const noexcept { return names.size(); }
+
+    private:
+        std::vector<std::pair<std::uint64_t, std::size_t>> points; // sorted by hash
+        std::vector<std::string> names;
+    };
+
+    /*
+     * Client for a cluster of cache_servers: keys are partitioned over the
+     * nodes by a consistent_hash_ring. A MultiGet / MultiPut splits its keys
+     * by node, sends one batch to every node involved before reading any
+     * answer, and reassembles the results in input order. Every node's
+     * answer is read before the first error is rethrown, and a connection
+     * broken by an error is reopened on its next use.
+     */
+    class cluster_client
+    {
+    public:
+        struct endpoint
+        {
+            std::string host;
+            std::uint16_t port;
+        };
+
+        explicit cluster_client(const std::vector<endpoint>& nodes,
+                                std::size_t replicas = consistent_hash_ring::default_replicas)
+        {
+            if (nodes.empty()) throw std::invalid_argument{"A cluster needs at least one node."};
+            for (const auto& node : nodes)
+            {
+                ring.AddNode(node.host + ":" + std::to_string(node.port), replicas);
+                connections.emplace_back(node.host, node.port);
+            }
+            endpoints = nodes;
+        }
+
+        std::vector<std::optional<std::string>> MultiGet(const std::vector<std::string>& keys)
+        {
+            std::vector<std::vector<std::size_t>> positions(connections.size());
+            std::vector<std::vector<std::string>> batches(connections.size());
+            for (std::size_t i = 0; i < keys.size(); ++i)
+            {
+                const std::size_t node = ring.NodeFor(keys[i]);
+                positions[node].push_back(i);
+                batches[node].push_back(keys[i]);
+            }
+
+            auto responses = Exchange(batches, [](cache_connection& c, const auto& batch) { return c.SendGet(batch); });
+            std::vector<std::optional<std::string>> values(keys.size());
+            for (std::size_t node = 0; node < connections.size(); ++node)
+            {
+                if (!responses[node]) continue;
+                auto result = cache_connection::Checked(std::move(*responses[node]));
+                for (std::size_t j = 0; j < result.values.size(); ++j)
+                {
+                    values[positions[node][j]] = std::move(result.values[j]);
+                }
+            }
+            return values;
+        }
+
+        void MultiPut(const std::vector<std::pair<std::string, std::string>>& entries)
+        {
+            std::vector<std::vector<std::pair<std::string, std::string>>> batches(connections.size());
+            for (const auto& entry : entries) batches[ring.NodeFor(entry.first)].push_back(entry);
+
+            auto responses = Exchange(batches, [](cache_connection& c, const auto& batch) { return c.SendPut(batch); });
+            for (auto& response : responses)
+            {
+                if (response) cache_connection::Checked(std::move(*response));
+            }
+        }
+
+        std::optional<std::string> Get(const std::string& key) { return Owner(key).Get(key); }
+        void Put(const std::string& key, const std::string& value) { Owner(key).Put(key, value); }
+        bool Remove(const std::string& key) { return Owner(key).Remove(key); }
+
+        // Connection to the node owning key, e.g. for hand-pipelined requests
+        cache_connection& Owner(std::string_view key) { return Connection(ring.NodeFor(key)); }
+
+        const consistent_hash_ring& Ring() const noexcept { return ring; }
+
+    private:
+        // Reopens a connection an earlier error broke
+        cache_connection& Connection(std::size_t node)
+        {
+            if (connections[node].Broken())
+            {
+                connections[node] = cache_connection{endpoints[node].host, endpoints[node].port};
+            }
+            return connections[node];
+        }
+
+        /*
+         * Sends each non-empty batch to its node, then collects one response
+         * per batch. A failing node doesn't stop the others: they are all
+         * sent to and read from, so none is left with a response queued,
+         * and then the first error is rethrown.
+         */
+        template <typename Batches, typename Send>
+        std::vector<std::optional<cache_connection::response>> Exchange(const Batches& batches, Send send)
+        {
+            std::exception_ptr error;
+            const auto attempt = [&](auto step) {
+                try
+                {
+                    step();
+                }
+                catch (...)
+                {
+                    if (!error) error = std::current_exception();
+                }
+            };
+
+            std::vector<std::optional<std::uint32_t>> ids(connections.size());
+            for (std::size_t node = 0; node < connections.size(); ++node)
+            {
+                if (!batches[node].empty()) attempt([&] { ids[node] = send(Connection(node), batches[node]); });
+            }
+            for (std::size_t node = 0; node < connections.size(); ++node)
+            {
+                if (ids[node]) attempt([&] { connections[node].Flush(); });
+            }
+
+            std::vector<std::optional<cache_connection::response>> responses(connections.size());
+            for (std::size_t node = 0; node < connections.size(); ++node)
+            {
+                if (ids[node] && !connections[node].Broken())
+                {
+                    attempt([&] { responses[node] = connections[node].Receive(*ids[node]); });
+                }
+            }
+            if (error) std::rethrow_exception(error);
+            return responses;
+        }
+
+        consistent_hash_ring ring;
+        std::vector<endpoint> endpoints;
+        std::vector<cache_connection> connections;
+    };
+} // namespace caches
+
+#endif
@@ -1,13 +1,118 @@
 #ifndef CACHE_POLICY_HPP
 #define CACHE_POLICY_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <unordered_set>
 #include <stdexcept>  // for std::runtime_error
+#include <type_traits>
+#include <utility>
 
 namespace caches
 {
+    /*
+     * Static cache policy contract.
+     * fixed_sized_cache is templated on the concrete Policy<Key>, so policies
+     * need no base class and their calls inline into Put/TryGet. A policy must
+     * provide:
+     *
+     *   void Insert(const Key& key);               // key was added to the cache
+     *   void Touch(const Key& key);                // key was read or updated
+     *   void Erase(const Key& key);                // key left the cache
+     *   const Key& ReplacementCandidate() const;   // key to evict next
+     *
+     * and may provide:
+     *
+     *   void Reserve(std::size_t capacity);        // capacity hint, called once
+     *   static constexpr bool concurrent_touch;    // see has_concurrent_touch
+     *   void Prefetch(const Key& key) const;       // Touch(key) follows soon
+     *   void ForEach(Visit visit) const;           // keys oldest first, see has_ordered_keys
+     *   Insert / Touch / Erase(const Key&, std::uint64_t hash);
+     *                                              // with hash == key_hash(key), see has_hashed_keys
+     *
+     * For runtime polymorphism implement ICachePolicy and plug it in through
+     * PolymorphicCachePolicy (see below).
+     */
+    template <typename Policy, typename Key, typename = void>
+    struct is_cache_policy : std::false_type {};
+
+    template <typename Policy, typename Key>
+    struct is_cache_policy<Policy, Key, std::void_t<
+        decltype(std::declval<Policy&>().Insert(std::declval<const Key&>())),
+        decltype(std::declval<Policy&>().Touch(std::declval<const Key&>())),
+        decltype(std::declval<Policy&>().Erase(std::declval<const Key&>())),
+        decltype(std::declval<const Policy&>().ReplacementCandidate())>>
+        : std::is_convertible<decltype(std::declval<const Policy&>().ReplacementCandidate()), const Key&> {};
+
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L
+    template <typename Policy, typename Key>
+    concept CachePolicy = is_cache_policy<Policy, Key>::value;
+#endif
+
+    // Policy accepts the optional Reserve(capacity) hint
+    template <typename Policy, typename = void>
+    struct has_reserve_hint : std::false_type {};
+
+    template <typename Policy>
+    struct has_reserve_hint<Policy, std::void_t<decltype(std::declval<Policy&>().Reserve(std::size_t{}))>>
+        : std::true_type {};
+
+    // Policy can start loading a key's bookkeeping ahead of Touch (batch lookups)
+    template <typename Policy, typename Key, typename = void>
+    struct has_prefetch_hint : std::false_type {};
+
+    template <typename Policy, typename Key>
+    struct has_prefetch_hint<Policy, Key, std::void_t<decltype(std::declval<const Policy&>().Prefetch(std::declval<const Key&>()))>>
+        : std::true_type {};
+
+    /*
+     * Policy can list its keys in the order that, inserted again, rebuilds
+     * its state (oldest first), so snapshots keep e.g. LRU recency
+     */
+    template <typename Policy, typename Key, typename = void>
+    struct has_ordered_keys : std::false_type {};
+
+    template <typename Policy, typename Key>
+    struct has_ordered_keys<Policy, Key, std::void_t<decltype(std::declval<const Policy&>().ForEach(
+        std::declval<void (*)(const Key&)>()))>>
+        : std::true_type {};
+
+    // Policy accepts the key's hash from the cache instead of hashing it again
+    template <typename Policy, typename Key, typename = void>
+    struct has_hashed_keys : std::false_type {};
+
+    template <typename Policy, typename Key>
+    struct has_hashed_keys<Policy, Key, std::void_t<
+        decltype(std::declval<Policy&>().Insert(std::declval<const Key&>(), std::uint64_t{})),
+        decltype(std::declval<Policy&>().Touch(std::declval<const Key&>(), std::uint64_t{})),
+        decltype(std::declval<Policy&>().Erase(std::declval<const Key&>(), std::uint64_t{}))>>
+        : std::true_type {};
+
+    /*
+     * True when Policy declares `static constexpr bool concurrent_touch = true`,
+     * i.e. Touch only reads the policy's structure (an atomic flag at most) and
+     * can run from several threads as long as no Insert/Erase runs alongside.
+     */
+    template <typename Policy, typename = void>
+    struct has_concurrent_touch : std::false_type {};
+
+    template <typename Policy>
+    struct has_concurrent_touch<Policy, std::void_t<decltype(Policy::concurrent_touch)>>
+        : std::bool_constant<Policy::concurrent_touch> {};
+
+    // Policy reports the heap bytes of its bookkeeping (fixed_sized_cache::MemoryUsage)
+    template <typename Policy, typename = void>
+    struct has_memory_usage : std::false_type {};
+
+    template <typename Policy>
+    struct has_memory_usage<Policy, std::void_t<decltype(std::declval<const Policy&>().MemoryUsage())>>
+        : std::true_type {};
+
     /*
      * Abstract cache policy interface for managing keys.
+     * Only needed when the policy is chosen at runtime; the built-in policies
+     * implement the static contract above directly.
      */
     template <typename Key>
     class ICachePolicy
@@ -15,6 +120,9 @@ namespace caches
     public:
         virtual ~ICachePolicy() = default;
 
+        // Capacity hint from the cache, lets policies preallocate their storage
+        virtual void Reserve(std::size_t capacity) { (void)capacity; }
+
         virtual void Insert(const Key& key) = 0;
         virtual void Touch(const Key& key) = 0;
         virtual void Erase(const Key& key) = 0;
@@ -27,26 +135,30 @@ namespace caches
      * Picks any key from the set to evict — not based on order.
      */
     template <typename Key>
-    class NoCachePolicy : public ICachePolicy<Key>
+    class NoCachePolicy
     {
     public:
         NoCachePolicy() = default;
-        ~NoCachePolicy() noexcept override = default;
+        ~NoCachePolicy() noexcept = default;
 
-        void Insert(const Key& key) override {
+        void Reserve(std::size_t capacity) {
+            key_storage.reserve(capacity);
+        }
+
+        void Insert(const Key& key) {
             key_storage.emplace(key);
         }
 
-        void Touch(const Key& key) noexcept override {
+        void Touch(const Key& key) noexcept {
             // No effect in this policy
             (void)key;
         }
 
-        void Erase(const Key& key) noexcept override {
+        void Erase(const Key& key) noexcept {
             key_storage.erase(key);
         }
 
-        const Key& ReplacementCandidate() const override {
+        const Key& ReplacementCandidate() const {
             if (key_storage.empty()) {
                 throw std::runtime_error("No keys available for replacement.");
             }
@@ -57,6 +169,62 @@ namespace caches
         std::unordered_set<Key> key_storage;
     };
 
+    /*
+     * Wraps a static policy so it can be used through ICachePolicy.
+     */
+    template <typename Key, template <typename> class Policy>
+    class CachePolicyAdapter : public ICachePolicy<Key>
+    {
+    public:
+        explicit CachePolicyAdapter(const Policy<Key>& policy = Policy<Key>{}) : policy{policy} {}
+        ~CachePolicyAdapter() noexcept override = default;
+
+        void Reserve(std::size_t capacity) override {
+            if constexpr (has_reserve_hint<Policy<Key>>::value) {
+                policy.Reserve(capacity);
+            }
+        }
+
+        void Insert(const Key& key) override { policy.Insert(key); }
+        void Touch(const Key& key) override { policy.Touch(key); }
+        void Erase(const Key& key) override { policy.Erase(key); }
+        const Key& ReplacementCandidate() const override { return policy.ReplacementCandidate(); }
+
+    private:
+        Policy<Key> policy;
+    };
+
+    /*
+     * Runtime-polymorphic policy for the cache's Policy slot: forwards every
+     * call through ICachePolicy. The cache copies its policy argument, and the
+     * copy shares the pointee, so give each cache its own ICachePolicy object.
+     * Defaults to NoCachePolicy behaviour.
+     */
+    template <typename Key>
+    class PolymorphicCachePolicy
+    {
+    public:
+        PolymorphicCachePolicy()
+            : impl{std::make_shared<CachePolicyAdapter<Key, NoCachePolicy>>()} {}
+
+        explicit PolymorphicCachePolicy(std::shared_ptr<ICachePolicy<Key>> policy)
+            : impl{std::move(policy)}
+        {
+            if (!impl) {
+                throw std::invalid_argument{"Policy must not be null."};
+            }
+        }
+
+        void Reserve(std::size_t capacity) { impl->Reserve(capacity); }
+        void Insert(const Key& key) { impl->Insert(key); }
+        void Touch(const Key& key) { impl->Touch(key); }
+        void Erase(const Key& key) { impl->Erase(key); }
+        const Key& ReplacementCandidate() const { return impl->ReplacementCandidate(); }
+
+    private:
+        std::shared_ptr<ICachePolicy<Key>> impl;
+    };
+
 } // namespace caches
 
-#endif 
\ No newline at end of file
+#endif
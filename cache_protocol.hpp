@@ -0,0 +1,237 @@
+#ifndef CACHE_PROTOCOL_HPP
+#define CACHE_PROTOCOL_HPP
+
+#include "hash_util.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+    /*
+     * Binary wire protocol of cache_server / cache_client. Every message is
+     * a frame: a 9-byte header, then `length` bytes of body. Integers are
+     * little-endian, strings are a u32 length followed by the bytes.
+     *
+     *   header   u32 length | u32 request_id | u8 opcode (request) or status (response)
+     *   get      u32 count | count x key            -> u32 count | count x (u8 found [| value]),
+     *                                                   or too_large past max_frame_size
+     *   put      u32 count | count x (key | value)  -> empty
+     *   remove   u32 count | count x key            -> u32 count | count x u8 removed
+     *
+     * Batches are first-class: a get of n keys is one frame and one
+     * MultiGet on the server. Frames can be pipelined: a client may send
+     * any number of them before reading, and the responses come back in
+     * request order with the request_id echoed.
+     */
+    namespace protocol
+    {
+        constexpr std::size_t header_size = 9;
+        constexpr std::uint32_t max_frame_size = 64u << 20; // body bytes
+
+        enum class opcode : std::uint8_t
+        {
+            get = 1,
+            put = 2,
+            remove = 3,
+        };
+
+        enum class status : std::uint8_t
+        {
+            ok = 0,
+            bad_request = 1, // malformed body or unknown opcode
+            too_large = 2,   // the answer wouldn't fit in max_frame_size
+        };
+
+        // Malformed frame; the connection can't be resynchronized after it
+        class protocol_error : public std::runtime_error
+        {
+        public:
+            using std::runtime_error::runtime_error;
+        };
+
+        struct frame_header
+        {
+            std::uint32_t length;
+            std::uint32_t request_id;
+            std::uint8_t code; // opcode or status
+        };
+
+        inline void AppendU32(std::string& out, std::uint32_t value)
+        {
+            const char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8),
+                                   static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+            out.append(bytes, 4);
+        }
+
+        inline void AppendBytes(std::string& out, std::string_view bytes)
+        {
+            if (bytes.size() > max_frame_size) throw protocol_error{"String too long for a frame."};
+            AppendU32(out, static_cast<std::uint32_t>(bytes.size()));
+            out.append(bytes.data(), bytes.size());
+        }
+
+        inline std::uint32_t LoadU32(const char* bytes) noexcept
+        {
+            const auto* b = reinterpret_cast<const unsigned char*>(bytes);
+            return std::uint32_t{b[0]} | std::uint32_t{b[1]} << 8 | std::uint32_t{b[2]} << 16 |
+                   std::uint32_t{b[3]} << 24;
+        }
+
+        /*
+         * Appends one frame to a buffer: the constructor writes the header
+         * with a placeholder length, the body is appended, End() patches the
+         * length in.
+         */
+        class frame_writer
+        {
+        public:
+            frame_writer(std::string& buffer, std::uint32_t request_id, std::uint8_t code) : out{buffer}, start{buffer.size()}
+            {
+                AppendU32(out, 0);
+                AppendU32(out, request_id);
+                out.push_back(static_cast<char>(code));
+            }
+
+            frame_writer& U8(std::uint8_t value)
+            {
+                out.push_back(static_cast<char>(value));
+                return *this;
+            }
+
+            frame_writer& U32(std::uint32_t value)
+            {
+                AppendU32(out, value);
+                return *this;
+            }
+
+            frame_writer& Bytes(std::string_view bytes)
+            {
+                AppendBytes(out, bytes);
+                return *this;
+            }
+
+            void End()
+            {
+                const std::size_t length = out.size() - start - header_size;
+                if (length > max_frame_size) throw protocol_error{"Frame too large."};
+                for (std::size_t i = 0; i < 4; ++i) out[start + i] = static_cast<char>(length >> (8 * i));
+            }
+
+        private:
+            std::string& out;
+            std::size_t start;
+        };
+
+        // Header of the frame at the front of `data`, or nullopt until all
+        // of it (header and body) has arrived
+        inline std::optional<frame_header> PeekFrame(std::string_view data)
+        {
+            if (data.size() < header_size) return std::nullopt;
+
+            frame_header header{LoadU32(data.data()), LoadU32(data.data() + 4), static_cast<std::uint8_t>(data[8])};
+            if (header.length > max_frame_size) throw protocol_error{"Frame too large."};
+            if (data.size() - header_size < header.length) return std::nullopt;
+            return header;
+        }
+
+        // Bounds-checked reads from a frame body
+        class frame_reader
+        {
+        public:
+            explicit frame_reader(std::string_view frame_body) : body{frame_body} {}
+
+            std::uint8_t U8()
+            {
+                Need(1);
+                return static_cast<std::uint8_t>(body[pos++]);
+            }
+
+            std::uint32_t U32()
+            {
+                Need(4);
+                const std::uint32_t value = LoadU32(body.data() + pos);
+                pos += 4;
+                return value;
+            }
+
+            // Valid while the frame's buffer is
+            std::string_view Bytes()
+            {
+                const std::uint32_t length = U32();
+                Need(length);
+                const std::string_view bytes = body.substr(pos, length);
+                pos += length;
+                return bytes;
+            }
+
+            // A count of items that take at least `min_item_size` bytes each
+            std::uint32_t Count(std::size_t min_item_size)
+            {
+                const std::uint32_t count = U32();
+                if (count > (body.size() - pos) / min_item_size) throw protocol_error{"Item count exceeds the frame."};
+                return count;
+            }
+
+            bool Done() const noexcept { return pos == body.size(); }
+
+        private:
+            void Need(std::size_t bytes) const
+            {
+                if (body.size() - pos < bytes) throw protocol_error{"Truncated frame."};
+            }
+
+            std::string_view body;
+            std::size_t pos = 0;
+        };
+
+        // Request builders, used by the client
+        inline void WriteGet(std::string& out, std::uint32_t request_id, const std::vector<std::string>& keys)
+        {
+            frame_writer frame{out, request_id, static_cast<std::uint8_t>(opcode::get)};
+            frame.U32(static_cast<std::uint32_t>(keys.size()));
+            for (const auto& key : keys) frame.Bytes(key);
+            frame.End();
+        }
+
+        inline void WritePut(std::string& out, std::uint32_t request_id,
+                             const std::vector<std::pair<std::string, std::string>>& entries)
+        {
+            frame_writer frame{out, request_id, static_cast<std::uint8_t>(opcode::put)};
+            frame.U32(static_cast<std::uint32_t>(entries.size()));
+            for (const auto& [key, value] : entries) frame.Bytes(key).Bytes(value);
+            frame.End();
+        }
+
+        inline void WriteRemove(std::string& out, std::uint32_t request_id, const std::vector<std::string>& keys)
+        {
+            frame_writer frame{out, request_id, static_cast<std::uint8_t>(opcode::remove)};
+            frame.U32(static_cast<std::uint32_t>(keys.size()));
+            for (const auto& key : keys) frame.Bytes(key);
+            frame.End();
+        }
+
+        /*
+         * Stable 64-bit hash of a byte string (FNV-1a, then remixed) for
+         * routing keys to nodes. Unlike std::hash it is the same in every
+         * process and on every platform, so all clients agree on the owner.
+         */
+        inline std::uint64_t RoutingHash(std::string_view bytes) noexcept
+        {
+            std::uint64_t h = 0xcbf29ce484222325ULL;
+            for (const char c : bytes)
+            {
+                h ^= static_cast<unsigned char>(c);
+                h *= 0x100000001b3ULL;
+            }
+            return mix_hash(h);
+        }
+    } // namespace protocol
+} // namespace caches
+
+#endif
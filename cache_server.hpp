@@ -0,0 +1,501 @@
+#ifndef CACHE_SERVER_HPP
+#define CACHE_SERVER_HPP
+
+#include "cache_protocol.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace caches
+{
+    /*
+     * TCP front-end for a thread-safe cache, speaking the binary protocol
+     * of cache_protocol.hpp (Linux, epoll). One worker per core runs its
+     * own event loop with its own SO_REUSEPORT listener, so the kernel
+     * spreads connections over the cores and a connection stays on the
+     * core that accepted it; no state is shared between workers except the
+     * cache. A get of n keys is one Cache::MultiGet, a put one MultiPut,
+     * and every complete frame in the input buffer is answered before the
+     * responses are written back in one send (pipelining).
+     * Cache - e.g. sharded_cache<std::string, std::string, LRUCachePolicy, 64>:
+     *         thread-safe, with TryGet, MultiGet, Put, MultiPut and Remove;
+     *         give it at least as many shards as workers
+     */
+    template <typename Cache>
+    class cache_server
+    {
+    public:
+        struct options
+        {
+            std::string address = "0.0.0.0";
+            std::uint16_t port = 11311;      // 0 picks a free port, see Port()
+            std::size_t workers = 0;         // 0 for one per hardware thread
+            bool pin_workers = true;         // bind worker i to CPU i
+            std::size_t max_output = 4 << 20; // stop reading a connection above this many unsent bytes
+        };
+
+        // Binds the listeners; Start() begins serving. Throws std::system_error.
+        cache_server(Cache& shared_cache, options opts) : cache{shared_cache}, config{std::move(opts)}
+        {
+            std::size_t count = config.workers != 0 ? config.workers : std::thread::hardware_concurrency();
+            count = std::max<std::size_t>(count, 1);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                // Worker 0 resolves port 0; the others join the same port
+                workers.push_back(std::make_unique<worker>(*this, i, i == 0 ? config.port : port));
+                if (i == 0) port = workers[0]->LocalPort();
+            }
+        }
+
+        cache_server(const cache_server&) = delete;
+        cache_server& operator=(const cache_server&) = delete;
+
+        ~cache_server() { Stop(); }
+
+        void Start()
+        {
+            for (auto& w : workers) w->Start();
+        }
+
+        // Stops the workers and closes every connection; idempotent
+        void Stop()
+        {
+            for (auto& w : workers) w->Stop();
+        }
+
+        std::uint16_t Port() const noexcept { return port; }
+        std::size_t Workers() const noexcept { return workers.size(); }
+
+    private:
+        struct connection
+        {
+            int fd;
+            std::string in;
+            std::string out;
+            std::size_t out_sent = 0;
+            std::uint32_t events = EPOLLIN; // what epoll watches for
+        };
+
+        class worker
+        {
+        public:
+            worker(cache_server& owner, std::size_t index, std::uint16_t bind_port) : server{owner}, id{index}
+            {
+                epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+                wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if (epoll_fd < 0 || wake_fd < 0)
+                {
+                    const int error = errno;
+                    Close();
+                    throw std::system_error{error, std::generic_category(), "Cannot create the event loop"};
+                }
+                try
+                {
+                    listen_fd = Listen(owner.config.address, bind_port);
+                    Watch(listen_fd, EPOLLIN);
+                    Watch(wake_fd, EPOLLIN);
+                }
+                catch (...)
+                {
+                    Close();
+                    throw;
+                }
+            }
+
+            ~worker()
+            {
+                Stop();
+                Close();
+            }
+
+            std::uint16_t LocalPort() const
+            {
+                sockaddr_in addr{};
+                socklen_t length = sizeof(addr);
+                ::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &length);
+                return ntohs(addr.sin_port);
+            }
+
+            void Start()
+            {
+                if (thread.joinable()) return;
+                thread = std::thread{[this] { Run(); }};
+            }
+
+            void Stop()
+            {
+                if (!thread.joinable()) return;
+                const std::uint64_t one = 1;
+                [[maybe_unused]] const auto written = ::write(wake_fd, &one, sizeof(one));
+                thread.join();
+            }
+
+        private:
+            static int Listen(const std::string& address, std::uint16_t port)
+            {
+                sockaddr_in addr{};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(port);
+                if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+                {
+                    throw std::invalid_argument{"Not an IPv4 address: " + address};
+                }
+
+                const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                if (fd < 0) throw std::system_error{errno, std::generic_category(), "Cannot create a socket"};
+                const int on = 1;
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+                if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0)
+                {
+                    const int error = errno;
+                    ::close(fd);
+                    throw std::system_error{error, std::generic_category(),
+                                            "Cannot listen on " + address + ":" + std::to_string(port)};
+                }
+                return fd;
+            }
+
+            void Watch(int fd, std::uint32_t events)
+            {
+                epoll_event event{};
+                event.events = events;
+                event.data.fd = fd;
+                if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+                {
+                    throw std::system_error{errno, std::generic_category(), "Cannot watch a socket"};
+                }
+            }
+
+            void Close() noexcept
+            {
+                for (const int fd : {listen_fd, wake_fd, epoll_fd})
+                {
+                    if (fd >= 0) ::close(fd);
+                }
+                listen_fd = wake_fd = epoll_fd = -1;
+            }
+
+            void Run()
+            {
+                if (server.config.pin_workers)
+                {
+                    const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    CPU_SET(id % cpus, &set);
+                    ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+                }
+
+                epoll_event events[64];
+                for (;;)
+                {
+                    const int ready = ::epoll_wait(epoll_fd, events, 64, -1);
+                    if (ready < 0 && errno == EINTR) continue;
+                    if (ready < 0) break;
+
+                    for (int i = 0; i < ready; ++i)
+                    {
+                        const int fd = events[i].data.fd;
+                        if (fd == wake_fd)
+                        {
+                            std::uint64_t count;
+                            [[maybe_unused]] const auto drained = ::read(wake_fd, &count, sizeof(count));
+                            connections.clear(); // shutting down
+                            return;
+                        }
+                        if (fd == listen_fd)
+                        {
+                            try
+                            {
+                                Accept();
+                            }
+                            catch (const std::exception&)
+                            {
+                                // out of memory for a new connection; it was closed
+                            }
+                            continue;
+                        }
+
+                        const auto found = connections.find(fd);
+                        if (found == connections.end()) continue;
+                        connection& conn = *found->second;
+                        bool open = true;
+                        // A failure serving one connection (bad_alloc, an
+                        // exception from the cache) only costs that one
+                        try
+                        {
+                            if (events[i].events & (EPOLLERR | EPOLLHUP)) open = false;
+                            if (open && (events[i].events & EPOLLOUT)) open = Flush(conn);
+                            if (open && (events[i].events & EPOLLIN)) open = Receive(conn);
+                            if (open) open = Serve(conn);
+                        }
+                        catch (const std::exception&)
+                        {
+                            open = false;
+                        }
+                        if (!open) Drop(fd);
+                    }
+                }
+            }
+
+            void Accept()
+            {
+                for (;;)
+                {
+                    const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0) return; // EAGAIN, or a connection that went away
+                    const int on = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+                    epoll_event event{};
+                    event.events = EPOLLIN;
+                    event.data.fd = fd;
+                    std::unique_ptr<connection, closer> conn;
+                    try
+                    {
+                        conn.reset(new connection{fd, {}, {}});
+                    }
+                    catch (...)
+                    {
+                        ::close(fd);
+                        throw;
+                    }
+                    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) continue; // closed with conn
+                    connections.emplace(fd, std::move(conn));
+                }
+            }
+
+            void Drop(int fd)
+            {
+                ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+                connections.erase(fd);
+            }
+
+            // Reads what's available; false once the peer closed or failed
+            bool Receive(connection& conn)
+            {
+                if (Backlogged(conn)) return true;
+
+                char buffer[64 * 1024];
+                for (;;)
+                {
+                    const ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+                    if (n > 0)
+                    {
+                        conn.in.append(buffer, static_cast<std::size_t>(n));
+                        if (static_cast<std::size_t>(n) < sizeof(buffer)) return true;
+                        continue;
+                    }
+                    if (n == 0) return false;
+                    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+                }
+            }
+
+            // Answers every complete frame, writing as it goes; false on a
+            // protocol error or a failed send
+            bool Serve(connection& conn)
+            {
+                for (;;)
+                {
+                    std::size_t consumed = 0;
+                    bool more = false;
+                    try
+                    {
+                        while (!(more = Backlogged(conn)))
+                        {
+                            const std::string_view pending = std::string_view{conn.in}.substr(consumed);
+                            const auto header = protocol::PeekFrame(pending);
+                            if (!header) break;
+
+                            Answer(*header, pending.substr(protocol::header_size, header->length), conn.out);
+                            consumed += protocol::header_size + header->length;
+                        }
+                    }
+                    catch (const protocol::protocol_error&)
+                    {
+                        return false;
+                    }
+                    conn.in.erase(0, consumed);
+                    if (!Flush(conn)) return false;
+
+                    // Stopped for a full output buffer that has drained since
+                    if (!more || Backlogged(conn)) return true;
+                }
+            }
+
+            bool Backlogged(const connection& conn) const noexcept
+            {
+                return conn.out.size() - conn.out_sent >= server.config.max_output;
+            }
+
+            void Answer(const protocol::frame_header& header, std::string_view body, std::string& out)
+            {
+                protocol::frame_reader request{body};
+                switch (static_cast<protocol::opcode>(header.code))
+                {
+                case protocol::opcode::get:
+                {
+                    const std::uint32_t count = request.Count(4);
+                    keys.clear();
+                    for (std::uint32_t i = 0; i < count; ++i) keys.emplace_back(request.Bytes());
+                    Finish(request);
+
+                    // The values, unlike the keys, aren't bounded by the
+                    // request's size: an answer that won't fit one frame is
+                    // replaced by a too_large status
+                    const std::size_t start = out.size();
+                    protocol::frame_writer response{out, header.request_id, static_cast<std::uint8_t>(protocol::status::ok)};
+                    response.U32(count);
+                    bool fits = true;
+                    const auto add = [&](const auto& value) {
+                        if (!fits) return;
+                        const std::size_t item_size = value ? 5 + value->size() : 1;
+                        if (out.size() - start - protocol::header_size + item_size > protocol::max_frame_size)
+                        {
+                            fits = false;
+                            return;
+                        }
+                        response.U8(value ? 1 : 0);
+                        if (value) response.Bytes(*value);
+                    };
+                    if (count == 1) add(server.cache.TryGet(keys[0]));
+                    else
+                    {
+                        for (const auto& value : server.cache.MultiGet(keys.begin(), keys.end())) add(value);
+                    }
+
+                    if (fits)
+                    {
+                        response.End();
+                        return;
+                    }
+                    out.resize(start);
+                    protocol::frame_writer{out, header.request_id, static_cast<std::uint8_t>(protocol::status::too_large)}.End();
+                    return;
+                }
+                case protocol::opcode::put:
+                {
+                    const std::uint32_t count = request.Count(8);
+                    entries.clear();
+                    for (std::uint32_t i = 0; i < count; ++i)
+                    {
+                        std::string key{request.Bytes()};
+                        entries.emplace_back(std::move(key), std::string{request.Bytes()});
+                    }
+                    Finish(request);
+
+                    if (count == 1) server.cache.Put(entries[0].first, entries[0].second);
+                    else server.cache.MultiPut(entries.begin(), entries.end());
+                    protocol::frame_writer{out, header.request_id, static_cast<std::uint8_t>(protocol::status::ok)}.End();
+                    return;
+                }
+                case protocol::opcode::remove:
+                {
+                    const std::uint32_t count = request.Count(4);
+                    protocol::frame_writer response{out, header.request_id, static_cast<std::uint8_t>(protocol::status::ok)};
+                    response.U32(count);
+                    keys.clear();
+                    for (std::uint32_t i = 0; i < count; ++i) keys.emplace_back(request.Bytes());
+                    Finish(request);
+                    for (const auto& key : keys) response.U8(server.cache.Remove(key) ? 1 : 0);
+                    response.End();
+                    return;
+                }
+                }
+                protocol::frame_writer{out, header.request_id, static_cast<std::uint8_t>(protocol::status::bad_request)}.End();
+            }
+
+            static void Finish(const protocol::frame_reader& request)
+            {
+                if (!request.Done()) throw protocol::protocol_error{"Trailing bytes in frame."};
+            }
+
+            // Sends pending output; watches for writability while some is left
+            bool Flush(connection& conn)
+            {
+                while (conn.out_sent < conn.out.size())
+                {
+                    const ssize_t n = ::send(conn.fd, conn.out.data() + conn.out_sent, conn.out.size() - conn.out_sent,
+                                             MSG_NOSIGNAL);
+                    if (n > 0)
+                    {
+                        conn.out_sent += static_cast<std::size_t>(n);
+                        continue;
+                    }
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    return false;
+                }
+
+                if (conn.out_sent == conn.out.size())
+                {
+                    conn.out.clear();
+                    conn.out_sent = 0;
+                }
+
+                // A backlogged connection isn't read until its output drains
+                const std::uint32_t events = (Backlogged(conn) ? 0u : std::uint32_t{EPOLLIN}) |
+                                             (conn.out_sent < conn.out.size() ? std::uint32_t{EPOLLOUT} : 0u);
+                if (events != conn.events)
+                {
+                    epoll_event event{};
+                    event.events = events;
+                    event.data.fd = conn.fd;
+                    ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &event);
+                    conn.events = events;
+                }
+                return true;
+            }
+
+            struct closer
+            {
+                void operator()(connection* conn) const noexcept
+                {
+                    ::close(conn->fd);
+                    delete conn;
+                }
+            };
+
+            cache_server& server;
+            std::size_t id;
+            int epoll_fd = -1;
+            int wake_fd = -1;
+            int listen_fd = -1;
+            std::thread thread;
+            std::unordered_map<int, std::unique_ptr<connection, closer>> connections;
+            std::vector<std::string> keys; // request scratch, reused
+            std::vector<std::pair<std::string, std::string>> entries;
+        };
+
+        Cache& cache;
+        options config;
+        std::uint16_t port = 0;
+        std::vector<std::unique_ptr<worker>> workers;
+    };
+} // namespace caches
+
+#endif
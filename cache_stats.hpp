@@ -0,0 +1,263 @@
+#ifndef CACHE_STATS_HPP
+#define CACHE_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace caches
+{
+    /*
+     * Statistics hooks for the Stats slot of fixed_sized_cache. A Stats type
+     * provides OnHit, OnMiss, OnInsert, OnUpdate and OnEviction, plus
+     * StartTimer / StopGet / StopPut around lookups and stores. no_stats is
+     * the default: every hook is empty and inlines away.
+     */
+    struct no_stats
+    {
+        struct timer {};
+
+        void OnHit() noexcept {}
+        void OnMiss() noexcept {}
+        void OnInsert() noexcept {}
+        void OnUpdate() noexcept {}
+        void OnEviction() noexcept {}
+
+        timer StartTimer() noexcept { return {}; }
+        void StopGet(timer) noexcept {}
+        void StopPut(timer) noexcept {}
+    };
+
+    // Stats also wants every looked-up key, as OnAccess(key, key_hash(key))
+    // (e.g. mrc_stats, which estimates miss-ratio curves)
+    template <typename Stats, typename Key, typename = void>
+    struct has_access_hook : std::false_type {};
+
+    template <typename Stats, typename Key>
+    struct has_access_hook<Stats, Key, std::void_t<decltype(std::declval<Stats&>().OnAccess(
+                                           std::declval<const Key&>(), std::uint64_t{}))>> : std::true_type {};
+
+    // Whether lookups can rely on the access hook not throwing (true without one)
+    template <typename Stats, typename Key, typename = void>
+    struct nothrow_access_hook : std::true_type {};
+
+    template <typename Stats, typename Key>
+    struct nothrow_access_hook<Stats, Key, std::enable_if_t<has_access_hook<Stats, Key>::value>>
+        : std::bool_constant<noexcept(std::declval<Stats&>().OnAccess(std::declval<const Key&>(), std::uint64_t{}))>
+    {
+    };
+
+    /*
+     * Latencies on a log2 scale: bucket i counts samples of [2^i, 2^(i+1))
+     * nanoseconds (bucket 0 also takes 0 ns).
+     */
+    class latency_histogram
+    {
+    public:
+        static constexpr std::size_t bucket_count = 48;
+
+        static std::size_t BucketOf(std::uint64_t nanos) noexcept
+        {
+            std::size_t bucket = 0;
+            while (nanos > 1 && bucket + 1 < bucket_count)
+            {
+                nanos >>= 1;
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        void Add(std::size_t bucket, std::uint64_t count) noexcept { buckets[bucket] += count; }
+
+        std::uint64_t Bucket(std::size_t bucket) const noexcept { return buckets[bucket]; }
+
+        std::uint64_t Count() const noexcept
+        {
+            std::uint64_t total = 0;
+            for (const auto count : buckets) total += count;
+            return total;
+        }
+
+        // Upper bound in nanoseconds of the bucket holding quantile q (0..1)
+        std::uint64_t Percentile(double q) const noexcept
+        {
+            const std::uint64_t total = Count();
+            if (total == 0) return 0;
+
+            const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < bucket_count; ++i)
+            {
+                seen += buckets[i];
+                if (seen > rank) return (std::uint64_t{1} << (i + 1)) - 1;
+            }
+            return (std::uint64_t{1} << bucket_count) - 1;
+        }
+
+        latency_histogram& operator+=(const latency_histogram& other) noexcept
+        {
+            for (std::size_t i = 0; i < bucket_count; ++i) buckets[i] += other.buckets[i];
+            return *this;
+        }
+
+    private:
+        std::array<std::uint64_t, bucket_count> buckets{};
+    };
+
+    // Point-in-time totals; snapshots of several shards add up
+    struct cache_stats_snapshot
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t inserts = 0;
+        std::uint64_t updates = 0;
+        std::uint64_t evictions = 0;
+        latency_histogram get_latency; // empty unless latencies are sampled
+        latency_histogram put_latency;
+
+        double HitRatio() const noexcept
+        {
+            const std::uint64_t lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+        }
+
+        cache_stats_snapshot& operator+=(const cache_stats_snapshot& other) noexcept
+        {
+            hits += other.hits;
+            misses += other.misses;
+            inserts += other.inserts;
+            updates += other.updates;
+            evictions += other.evictions;
+            get_latency += other.get_latency;
+            put_latency += other.put_latency;
+            return *this;
+        }
+    };
+
+    /*
+     * Relaxed event counter. Every cache (and every shard of a sharded_cache)
+     * owns its own, written only by the thread that holds it, so the add
+     * never contends. The exception is lookups under a shared shard lock,
+     * which already contend on that lock. Reads are safe from any thread.
+     */
+    class stat_counter
+    {
+    public:
+        stat_counter() = default;
+        stat_counter(const stat_counter& other) noexcept : value{other.Load()} {}
+
+        stat_counter& operator=(const stat_counter& other) noexcept
+        {
+            value.store(other.Load(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        void Add(std::uint64_t count = 1) noexcept { value.fetch_add(count, std::memory_order_relaxed); }
+        std::uint64_t Load() const noexcept { return value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    /*
+     * Counting Stats for fixed_sized_cache / sharded_cache.
+     * SampleEvery - when non-zero, one in SampleEvery lookups and stores per
+     *               thread is timed into a latency histogram (rounded up to a
+     *               power of two); zero keeps only the counters
+     */
+    template <std::size_t SampleEvery = 0>
+    class cache_stats
+    {
+        static constexpr bool sampled = SampleEvery != 0;
+
+        using clock = std::chrono::steady_clock;
+
+    public:
+        // Start of a sampled operation, or time_point{} when not sampled
+        struct timer
+        {
+            clock::time_point start{};
+        };
+
+        void OnHit() noexcept { hits.Add(); }
+        void OnMiss() noexcept { misses.Add(); }
+        void OnInsert() noexcept { inserts.Add(); }
+        void OnUpdate() noexcept { updates.Add(); }
+        void OnEviction() noexcept { evictions.Add(); }
+
+        timer StartTimer() noexcept
+        {
+            if constexpr (sampled)
+            {
+                // Per-thread tick: deciding to sample needs no shared write
+                static thread_local std::size_t tick = 0;
+                if ((++tick & (sample_period - 1)) == 0) return {clock::now()};
+            }
+            return {};
+        }
+
+        void StopGet(timer t) noexcept { Record(get_latency, t); }
+        void StopPut(timer t) noexcept { Record(put_latency, t); }
+
+        cache_stats_snapshot Snapshot() const noexcept
+        {
+            cache_stats_snapshot snapshot;
+            snapshot.hits = hits.Load();
+            snapshot.misses = misses.Load();
+            snapshot.inserts = inserts.Load();
+            snapshot.updates = updates.Load();
+            snapshot.evictions = evictions.Load();
+            if constexpr (sampled)
+            {
+                for (std::size_t i = 0; i < latency_histogram::bucket_count; ++i)
+                {
+                    snapshot.get_latency.Add(i, get_latency[i].Load());
+                    snapshot.put_latency.Add(i, put_latency[i].Load());
+                }
+            }
+            return snapshot;
+        }
+
+    private:
+        static constexpr std::size_t PowerOfTwoAtLeast(std::size_t n) noexcept
+        {
+            std::size_t period = 1;
+            while (period < n) period *= 2;
+            return period;
+        }
+
+        static constexpr std::size_t sample_period = PowerOfTwoAtLeast(SampleEvery);
+
+        using live_histogram = std::array<stat_counter, sampled ? latency_histogram::bucket_count : 0>;
+
+        void Record(live_histogram& histogram, timer t) noexcept
+        {
+            if constexpr (sampled)
+            {
+                if (t.start == clock::time_point{}) return;
+
+                const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t.start);
+                histogram[latency_histogram::BucketOf(static_cast<std::uint64_t>(elapsed.count()))].Add();
+            }
+            else
+            {
+                (void)histogram;
+                (void)t;
+            }
+        }
+
+        stat_counter hits;
+        stat_counter misses;
+        stat_counter inserts;
+        stat_counter updates;
+        stat_counter evictions;
+        live_histogram get_latency;
+        live_histogram put_latency;
+    };
+} // namespace caches
+
+#endif
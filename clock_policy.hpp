@@ -0,0 +1,112 @@
+#ifndef CLOCK_CACHE_POLICY_HPP
+#define CLOCK_CACHE_POLICY_HPP
+
+#include "cache_policy.hpp"
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace caches
+{
+    /*
+     * CLOCK (second chance) Cache Policy
+     * Approximates LRU: a hit only sets an atomic reference bit, and the clock
+     * hand clears bits while sweeping for an unreferenced victim. Touch never
+     * changes the policy's structure, so concurrent hits are safe as long as no
+     * Insert/Erase runs at the same time (see concurrent_touch).
+     */
+    template <typename Key>
+    class ClockCachePolicy
+    {
+    public:
+        // Touch may run concurrently with other Touch calls
+        static constexpr bool concurrent_touch = true;
+
+        ClockCachePolicy() = default;
+        ~ClockCachePolicy() noexcept = default;
+
+        void Insert(const Key& key) {
+            if (key_index.find(key) != key_index.end()) return; // prevent duplicate
+
+            std::size_t slot_id;
+            if (free_slots.empty()) {
+                slot_id = clock_slots.size();
+                clock_slots.emplace_back(key);
+            } else {
+                slot_id = free_slots.back();
+                free_slots.pop_back();
+                clock_slots[slot_id].key = key;
+                clock_slots[slot_id].occupied = true;
+                clock_slots[slot_id].referenced.store(false, std::memory_order_relaxed);
+            }
+            key_index.emplace(key, slot_id);
+        }
+
+        void Touch(const Key& key) noexcept {
+            auto it = key_index.find(key);
+            if (it == key_index.end()) return;
+
+            // Only write when the bit is clear, so hot keys don't keep
+            // dirtying a shared cache line
+            auto& referenced = clock_slots[it->second].referenced;
+            if (!referenced.load(std::memory_order_relaxed)) {
+                referenced.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        void Erase(const Key& key) noexcept {
+            auto it = key_index.find(key);
+            if (it == key_index.end()) return;
+
+            clock_slots[it->second].occupied = false;
+            free_slots.push_back(it->second);
+            key_index.erase(it);
+        }
+
+        const Key& ReplacementCandidate() const {
+            if (key_index.empty()) {
+                throw std::runtime_error("No keys available for eviction (CLOCK).");
+            }
+
+            // Two full turns are enough: the first clears every reference bit
+            while (true) {
+                if (clock_hand >= clock_slots.size()) clock_hand = 0;
+
+                const clock_slot& slot = clock_slots[clock_hand++];
+                if (slot.occupied) {
+                    // The hand moves past the victim, so the entry that reuses
+                    // its slot isn't the next one examined
+                    if (!slot.referenced.load(std::memory_order_relaxed)) {
+                        return slot.key;
+                    }
+                    slot.referenced.store(false, std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct clock_slot {
+            explicit clock_slot(const Key& k) : key{k} {}
+
+            clock_slot(const clock_slot& other)
+                : key{other.key},
+                  referenced{other.referenced.load(std::memory_order_relaxed)},
+                  occupied{other.occupied} {}
+
+            Key key;
+            mutable std::atomic<bool> referenced{false};
+            bool occupied = true;
+        };
+
+        // deque never relocates existing slots, which the atomics require
+        std::deque<clock_slot> clock_slots;
+        std::vector<std::size_t> free_slots;
+        std::unordered_map<Key, std::size_t> key_index;
+        mutable std::size_t clock_hand = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,397 @@
+#ifndef COMPRESSED_CACHE_HPP
+#define COMPRESSED_CACHE_HPP
+
+#include "cache.hpp"
+#include "lru_policy.hpp"
+#include "weigher.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#if __has_include(<lz4.h>)
+#include <lz4.h>
+#define CACHES_HAVE_LZ4 1
+#endif
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define CACHES_HAVE_ZSTD 1
+#endif
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define CACHES_HAVE_ZLIB 1
+#endif
+
+namespace caches
+{
+    /*
+     * A value codec for compressed_cache provides:
+     *
+     *   static constexpr std::uint8_t id;   // non-zero, stored with each entry
+     *   static void Compress(std::string_view raw, std::string& out);
+     *   static void Decompress(std::string_view packed, char* out, std::size_t raw_size);
+     *
+     * Decompress writes exactly raw_size bytes or throws std::runtime_error.
+     * lz_codec needs nothing beyond the standard library; lz4_codec,
+     * zstd_codec and zlib_codec are defined when their headers are found
+     * (link with -llz4, -lzstd or -lz).
+     */
+
+    /*
+     * Byte-oriented LZ77 in the spirit of LZ4: a run of literals followed by
+     * a back-reference of at least 4 bytes within the last 64 KiB. Each
+     * sequence starts with a token whose high nibble is the literal count
+     * and low nibble the match length - 4; 15 means more length bytes follow
+     * (each adding up to 255). The last sequence has literals only.
+     */
+    struct lz_codec
+    {
+        static constexpr std::uint8_t id = 1;
+
+        static void Compress(std::string_view raw, std::string& out)
+        {
+            out.clear();
+            out.reserve(raw.size() + raw.size() / 255 + 16);
+
+            const char* const in = raw.data();
+            const std::size_t n = raw.size();
+            std::array<std::uint32_t, std::size_t{1} << hash_bits> table{}; // position + 1, 0 = empty
+
+            std::size_t anchor = 0;
+            std::size_t i = 0;
+            while (n >= min_match && i + min_match <= n)
+            {
+                const std::uint32_t sequence = Load32(in + i);
+                std::uint32_t& slot = table[(sequence * 2654435761u) >> (32 - hash_bits)];
+                const std::size_t candidate = slot;
+                slot = static_cast<std::uint32_t>(i + 1);
+
+                if (candidate != 0 && i - (candidate - 1) <= max_offset && Load32(in + candidate - 1) == sequence)
+                {
+                    const std::size_t match = candidate - 1;
+                    std::size_t length = min_match;
+                    while (i + length < n && in[match + length] == in[i + length]) ++length;
+
+                    EmitSequence(out, in + anchor, i - anchor, i - match, length);
+                    i += length;
+                    anchor = i;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            EmitSequence(out, in + anchor, n - anchor, 0, 0);
+        }
+
+        static void Decompress(std::string_view packed, char* out, std::size_t raw_size)
+        {
+            const auto* ip = reinterpret_cast<const unsigned char*>(packed.data());
+            const auto* const end = ip + packed.size();
+            std::size_t op = 0;
+
+            while (ip < end)
+            {
+                const unsigned token = *ip++;
+                const std::size_t literals = ReadLength(token >> 4, ip, end);
+                if (literals > static_cast<std::size_t>(end - ip) || literals > raw_size - op) Corrupt();
+                std::memcpy(out + op, ip, literals);
+                ip += literals;
+                op += literals;
+                if (ip == end) break;
+
+                if (end - ip < 2) Corrupt();
+                const std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+                ip += 2;
+                const std::size_t length = ReadLength(token & 15u, ip, end) + min_match;
+                if (offset == 0 || offset > op || length > raw_size - op) Corrupt();
+
+                const char* from = out + op - offset;
+                if (offset >= length)
+                {
+                    std::memcpy(out + op, from, length);
+                }
+                else
+                {
+                    // The source overlaps what is being written: a repeating run
+                    for (std::size_t k = 0; k < length; ++k) out[op + k] = from[k];
+                }
+                op += length;
+            }
+            if (op != raw_size) Corrupt();
+        }
+
+    private:
+        static constexpr std::size_t min_match = 4;
+        static constexpr std::size_t max_offset = 65535;
+        static constexpr unsigned hash_bits = 12;
+
+        static std::uint32_t Load32(const char* p) noexcept
+        {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        static void PutLength(std::string& out, std::size_t extra)
+        {
+            for (; extra >= 255; extra -= 255) out.push_back(static_cast<char>(255));
+            out.push_back(static_cast<char>(extra));
+        }
+
+        // length == 0 writes the final, literal-only sequence
+        static void EmitSequence(std::string& out, const char* literals, std::size_t literal_count,
+                                 std::size_t offset, std::size_t length)
+        {
+            const std::size_t match_code = length == 0 ? 0 : length - min_match;
+            const unsigned high = literal_count < 15 ? static_cast<unsigned>(literal_count) : 15u;
+            const unsigned low = match_code < 15 ? static_cast<unsigned>(match_code) : 15u;
+            out.push_back(static_cast<char>((high << 4) | low));
+            if (high == 15) PutLength(out, literal_count - 15);
+            out.append(literals, literal_count);
+            if (length == 0) return;
+
+            out.push_back(static_cast<char>(offset & 0xff));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (low == 15) PutLength(out, match_code - 15);
+        }
+
+        static std::size_t ReadLength(unsigned nibble, const unsigned char*& ip, const unsigned char* end)
+        {
+            std::size_t length = nibble;
+            if (nibble != 15) return length;
+            for (;;)
+            {
+                if (ip == end) Corrupt();
+                const unsigned byte = *ip++;
+                length += byte;
+                if (byte != 255) return length;
+            }
+        }
+
+        [[noreturn]] static void Corrupt() { throw std::runtime_error{"Corrupt compressed value."}; }
+    };
+
+#ifdef CACHES_HAVE_LZ4
+    struct lz4_codec
+    {
+        static constexpr std::uint8_t id = 2;
+
+        static void Compress(std::string_view raw, std::string& out)
+        {
+            out.resize(static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(raw.size()))));
+            const int size = LZ4_compress_default(raw.data(), out.data(), static_cast<int>(raw.size()),
+                                                  static_cast<int>(out.size()));
+            out.resize(size > 0 ? static_cast<std::size_t>(size) : 0);
+        }
+
+        static void Decompress(std::string_view packed, char* out, std::size_t raw_size)
+        {
+            const int size = LZ4_decompress_safe(packed.data(), out, static_cast<int>(packed.size()),
+                                                 static_cast<int>(raw_size));
+            if (size < 0 || static_cast<std::size_t>(size) != raw_size)
+            {
+                throw std::runtime_error{"Corrupt compressed value."};
+            }
+        }
+    };
+#endif
+
+#ifdef CACHES_HAVE_ZSTD
+    template <int Level = 3>
+    struct zstd_codec
+    {
+        static constexpr std::uint8_t id = 3;
+
+        static void Compress(std::string_view raw, std::string& out)
+        {
+            out.resize(ZSTD_compressBound(raw.size()));
+            const std::size_t size = ZSTD_compress(out.data(), out.size(), raw.data(), raw.size(), Level);
+            out.resize(ZSTD_isError(size) ? 0 : size);
+        }
+
+        static void Decompress(std::string_view packed, char* out, std::size_t raw_size)
+        {
+            const std::size_t size = ZSTD_decompress(out, raw_size, packed.data(), packed.size());
+            if (ZSTD_isError(size) || size != raw_size)
+            {
+                throw std::runtime_error{"Corrupt compressed value."};
+            }
+        }
+    };
+#endif
+
+#ifdef CACHES_HAVE_ZLIB
+    template <int Level = Z_DEFAULT_COMPRESSION>
+    struct zlib_codec
+    {
+        static constexpr std::uint8_t id = 4;
+
+        static void Compress(std::string_view raw, std::string& out)
+        {
+            uLongf size = compressBound(static_cast<uLong>(raw.size()));
+            out.resize(size);
+            const int rc = compress2(reinterpret_cast<Bytef*>(out.data()), &size,
+                                     reinterpret_cast<const Bytef*>(raw.data()), static_cast<uLong>(raw.size()), Level);
+            out.resize(rc == Z_OK ? size : 0);
+        }
+
+        static void Decompress(std::string_view packed, char* out, std::size_t raw_size)
+        {
+            uLongf size = static_cast<uLongf>(raw_size);
+            const int rc = uncompress(reinterpret_cast<Bytef*>(out), &size,
+                                      reinterpret_cast<const Bytef*>(packed.data()), static_cast<uLong>(packed.size()));
+            if (rc != Z_OK || size != raw_size)
+            {
+                throw std::runtime_error{"Corrupt compressed value."};
+            }
+        }
+    };
+#endif
+
+    /*
+     * A stored value: the raw bytes, or the output of the codec whose id is
+     * recorded next to them. codec 0 means stored as is.
+     */
+    struct compressed_value
+    {
+        std::string bytes;
+        std::uint32_t raw_size = 0;
+        std::uint8_t codec = 0;
+
+        bool Compressed() const noexcept { return codec != 0; }
+    };
+
+    // Weighs the stored bytes, so memory_weigher budgets compressed sizes
+    inline std::size_t estimated_size(const compressed_value& value) noexcept
+    {
+        return sizeof(value) + estimated_size(value.bytes) - sizeof(value.bytes);
+    }
+
+    /*
+     * Cache of byte-string values (e.g. JSON blobs) that keeps large values
+     * compressed. Each entry is compressed with Codec when it is at least
+     * `threshold` bytes and compression saves at least 1/8 of it, and is
+     * stored raw otherwise; lookups decompress, either into a new string or
+     * into a caller's buffer. With the default memory_weigher the capacity
+     * is a byte budget charged with the compressed size.
+     * Key - Type of the key
+     * Codec - Value codec (see lz_codec)
+     * Policy - Eviction policy
+     * HashMap - Map container holding compressed_value
+     * Weigher - Entry cost function; memory_weigher or unit_weigher
+     */
+    template <typename Key, typename Codec = lz_codec, template <typename> class Policy = LRUCachePolicy,
+              typename HashMap = std::unordered_map<Key, compressed_value>, typename Weigher = memory_weigher>
+    class compressed_cache
+    {
+        static_assert(Codec::id != 0, "Codec id 0 is reserved for values stored uncompressed.");
+
+    public:
+        using key_type = Key;
+        using mapped_type = compressed_value;
+        using cache_type = fixed_sized_cache<Key, compressed_value, Policy, HashMap, Weigher>;
+
+        /*
+         * Constructor
+         * max_size - Byte budget (entry count with unit_weigher)
+         * threshold - Values shorter than this are never compressed
+         */
+        explicit compressed_cache(std::size_t max_size, std::size_t threshold = 1024)
+            : cache{max_size}, threshold{threshold}
+        {
+        }
+
+        void Put(const Key& key, std::string_view value)
+        {
+            if (value.size() > UINT32_MAX)
+            {
+                throw std::length_error{"Compressed cache values are limited to 4 GiB."};
+            }
+            cache.Put(key, Pack(value));
+        }
+
+        // Decompressed copy of the value; nullopt on a miss
+        std::optional<std::string> TryGet(const Key& key)
+        {
+            std::string out;
+            if (!TryGet(key, out)) return std::nullopt;
+            return out;
+        }
+
+        // Decompresses into `out` (reusing its capacity); false on a miss
+        bool TryGet(const Key& key, std::string& out)
+        {
+            const auto found = cache.TryGet(key);
+            if (!found.second) return false;
+
+            const compressed_value& stored = found.first->second;
+            out.resize(stored.raw_size);
+            Unpack(stored, out.data());
+            return true;
+        }
+
+        // The stored form, for callers that decompress lazily (see Unpack);
+        // valid until the entry is next modified or evicted
+        const compressed_value* TryGetStored(const Key& key)
+        {
+            const auto found = cache.TryGet(key);
+            return found.second ? &found.first->second : nullptr;
+        }
+
+        // Writes the stored value's raw_size bytes to out
+        static void Unpack(const compressed_value& stored, char* out)
+        {
+            if (stored.codec == 0)
+            {
+                std::memcpy(out, stored.bytes.data(), stored.raw_size);
+            }
+            else if (stored.codec == Codec::id)
+            {
+                Codec::Decompress(stored.bytes, out, stored.raw_size);
+            }
+            else
+            {
+                throw std::runtime_error{"Value was compressed with another codec."};
+            }
+        }
+
+        bool Cached(const Key& key) const noexcept { return cache.Cached(key); }
+        bool Remove(const Key& key) { return cache.Remove(key); }
+        void Clear() { cache.Clear(); }
+
+        std::size_t Size() const noexcept { return cache.Size(); }
+        std::size_t Weight() const noexcept { return cache.Weight(); }
+        std::size_t MaxSize() const noexcept { return cache.MaxSize(); }
+
+    private:
+        compressed_value Pack(std::string_view value)
+        {
+            compressed_value stored;
+            stored.raw_size = static_cast<std::uint32_t>(value.size());
+            if (value.size() >= threshold)
+            {
+                Codec::Compress(value, scratch);
+                if (!scratch.empty() && scratch.size() <= value.size() - value.size() / 8)
+                {
+                    stored.bytes.assign(scratch.data(), scratch.size());
+                    stored.codec = Codec::id;
+                    return stored;
+                }
+            }
+            stored.bytes.assign(value.data(), value.size());
+            return stored;
+        }
+
+        cache_type cache;
+        std::size_t threshold;
+        std::string scratch; // compressor output, reused across Puts
+    };
+} // namespace caches
+
+#endif
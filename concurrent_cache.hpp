@@ -0,0 +1,314 @@
+#ifndef CONCURRENT_CACHE_HPP
+#define CONCURRENT_CACHE_HPP
+
+#include "epoch.hpp"
+#include "hash_util.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace caches
+{
+    /*
+     * Concurrent cache engine with lock-free lookups, an alternative to
+     * sharded_cache when reads dominate. Entries are immutable and live in
+     * an open-addressed table of atomic pointers; a lookup probes the table
+     * inside an epoch guard and never takes a lock. Writers serialize on one
+     * mutex, publish a new entry with a single pointer store and retire the
+     * old one to epoch_domain, which frees it after the last reader that
+     * could see it has left. Eviction is CLOCK: a hit only sets the entry's
+     * reference bit, and only if it is clear, so hot entries are read-only.
+     * Key - Type of the key
+     * Value - Type of value (copied out by TryGet; see Visit to avoid it)
+     * Hash - Hash of Key
+     * KeyEqual - Equality of Key
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class concurrent_cache
+    {
+        struct entry
+        {
+            template <typename V>
+            entry(const Key& key, V&& value, std::uint64_t hash)
+                : key{key}, value{std::forward<V>(value)}, hash{hash}
+            {
+            }
+
+            const Key key;
+            const Value value;
+            const std::uint64_t hash;
+            // CLOCK bit; set at first, so the hand passes a new entry once
+            // whatever its slot
+            mutable std::atomic<bool> referenced{true};
+        };
+
+        // Marks a slot whose entry was removed; probes go on past it (a
+        // nullptr slot ends them). Never dereferenced.
+        static entry* Tombstone() noexcept
+        {
+            alignas(entry) static char sentinel;
+            return reinterpret_cast<entry*>(&sentinel);
+        }
+
+        struct table
+        {
+            explicit table(std::size_t slot_count) : mask{slot_count - 1}, slots{new std::atomic<entry*>[slot_count]}
+            {
+                for (std::size_t i = 0; i < slot_count; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+
+            std::size_t mask;
+            std::unique_ptr<std::atomic<entry*>[]> slots;
+        };
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+
+        /*
+         * Constructor
+         * max_size - Maximum number of entries; the table gets at least twice
+         *            as many slots so probes stay short
+         */
+        explicit concurrent_cache(std::size_t max_size) : max_cache_size{max_size}
+        {
+            if (max_cache_size == 0)
+            {
+                throw std::invalid_argument{"Cache size must be greater than zero."};
+            }
+            slot_count = 2;
+            while (slot_count < 2 * max_cache_size) slot_count *= 2;
+            current.store(new table{slot_count}, std::memory_order_release);
+        }
+
+        concurrent_cache(const concurrent_cache&) = delete;
+        concurrent_cache& operator=(const concurrent_cache&) = delete;
+
+        // No reader may be inside the cache any more
+        ~concurrent_cache()
+        {
+            table* t = current.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i <= t->mask; ++i)
+            {
+                entry* e = t->slots[i].load(std::memory_order_relaxed);
+                if (IsEntry(e)) delete e;
+            }
+            delete t;
+        }
+
+        // Adds or replaces an entry; readers see either the old or the new value
+        template <typename V>
+        void Put(const Key& key, V&& value)
+        {
+            const std::uint64_t hash = HashOf(key);
+            auto* fresh = new entry{key, std::forward<V>(value), hash};
+
+            std::lock_guard<std::mutex> guard{write_lock};
+            table* t = current.load(std::memory_order_relaxed);
+
+            if (std::atomic<entry*>* slot = Find(*t, key, hash))
+            {
+                entry* old = slot->load(std::memory_order_relaxed);
+                slot->store(fresh, std::memory_order_release);
+                epoch_domain::Global().Retire(old);
+                return;
+            }
+
+            if (size == max_cache_size) EvictOne(*t);
+            if (size + tombstones >= slot_count - slot_count / 4) t = Rebuild();
+
+            // The key is absent, so the first free slot on its probe path is its place
+            for (std::size_t i = hash & t->mask;; i = (i + 1) & t->mask)
+            {
+                entry* e = t->slots[i].load(std::memory_order_relaxed);
+                if (!IsEntry(e))
+                {
+                    if (e == Tombstone()) --tombstones;
+                    t->slots[i].store(fresh, std::memory_order_release);
+                    break;
+                }
+            }
+            ++size;
+        }
+
+        // Copy of the value; nullopt on a miss. Never blocks.
+        std::optional<Value> TryGet(const Key& key) const
+        {
+            std::optional<Value> result;
+            Visit(key, [&result](const Value& value) { result.emplace(value); });
+            return result;
+        }
+
+        /*
+         * Calls visit(value) on a hit, in place and still inside the epoch
+         * guard, so the value can't be freed meanwhile. Returns whether the
+         * key was found. visit must not block for long: retired entries wait
+         * for it.
+         */
+        template <typename Visitor>
+        bool Visit(const Key& key, Visitor&& visit) const
+        {
+            const std::uint64_t hash = HashOf(key);
+            epoch_domain::guard pin;
+            const entry* e = Lookup(key, hash);
+            if (e == nullptr) return false;
+
+            if (!e->referenced.load(std::memory_order_relaxed))
+            {
+                e->referenced.store(true, std::memory_order_relaxed);
+            }
+            visit(e->value);
+            return true;
+        }
+
+        // Whether key is resident; doesn't mark it referenced
+        bool Cached(const Key& key) const
+        {
+            const std::uint64_t hash = HashOf(key);
+            epoch_domain::guard pin;
+            return Lookup(key, hash) != nullptr;
+        }
+
+        // Remove a key, return true if it existed
+        bool Remove(const Key& key)
+        {
+            const std::uint64_t hash = HashOf(key);
+            std::lock_guard<std::mutex> guard{write_lock};
+            table* t = current.load(std::memory_order_relaxed);
+
+            std::atomic<entry*>* slot = Find(*t, key, hash);
+            if (slot == nullptr) return false;
+            Vacate(*slot);
+            return true;
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> guard{write_lock};
+            table* old = current.load(std::memory_order_relaxed);
+            current.store(new table{slot_count}, std::memory_order_release);
+
+            auto& domain = epoch_domain::Global();
+            for (std::size_t i = 0; i <= old->mask; ++i)
+            {
+                entry* e = old->slots[i].load(std::memory_order_relaxed);
+                if (IsEntry(e)) domain.Retire(e);
+            }
+            domain.Retire(old);
+            size = 0;
+            tombstones = 0;
+            clock_hand = 0;
+        }
+
+        std::size_t Size() const
+        {
+            std::lock_guard<std::mutex> guard{write_lock};
+            return size;
+        }
+
+        std::size_t MaxSize() const noexcept { return max_cache_size; }
+
+    private:
+        static bool IsEntry(const entry* e) noexcept { return e != nullptr && e != Tombstone(); }
+
+        static std::uint64_t HashOf(const Key& key) noexcept(noexcept(Hash{}(key)))
+        {
+            return mix_hash(static_cast<std::uint64_t>(Hash{}(key)));
+        }
+
+        // Reader side: may run concurrently with writers
+        const entry* Lookup(const Key& key, std::uint64_t hash) const
+        {
+            const table* t = current.load(std::memory_order_acquire);
+            std::size_t i = hash & t->mask;
+            for (std::size_t probes = 0; probes <= t->mask; ++probes, i = (i + 1) & t->mask)
+            {
+                const entry* e = t->slots[i].load(std::memory_order_acquire);
+                if (e == nullptr) return nullptr;
+                if (e != Tombstone() && e->hash == hash && KeyEqual{}(e->key, key)) return e;
+            }
+            return nullptr;
+        }
+
+        // Writer side: the slot holding key, or nullptr
+        std::atomic<entry*>* Find(table& t, const Key& key, std::uint64_t hash) const
+        {
+            std::size_t i = hash & t.mask;
+            for (std::size_t probes = 0; probes <= t.mask; ++probes, i = (i + 1) & t.mask)
+            {
+                entry* e = t.slots[i].load(std::memory_order_relaxed);
+                if (e == nullptr) return nullptr;
+                if (e != Tombstone() && e->hash == hash && KeyEqual{}(e->key, key)) return &t.slots[i];
+            }
+            return nullptr;
+        }
+
+        void Vacate(std::atomic<entry*>& slot)
+        {
+            entry* e = slot.load(std::memory_order_relaxed);
+            slot.store(Tombstone(), std::memory_order_release);
+            epoch_domain::Global().Retire(e);
+            --size;
+            ++tombstones;
+        }
+
+        // CLOCK sweep: clears reference bits until it meets an unreferenced entry
+        void EvictOne(table& t)
+        {
+            for (;;)
+            {
+                std::atomic<entry*>& slot = t.slots[clock_hand];
+                clock_hand = (clock_hand + 1) & t.mask;
+
+                entry* e = slot.load(std::memory_order_relaxed);
+                if (!IsEntry(e)) continue;
+                if (e->referenced.load(std::memory_order_relaxed))
+                {
+                    e->referenced.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+                Vacate(slot);
+                return;
+            }
+        }
+
+        // Tombstones only shorten with a fresh table; readers keep the old one
+        // until they leave their epoch
+        table* Rebuild()
+        {
+            table* old = current.load(std::memory_order_relaxed);
+            auto* fresh = new table{slot_count};
+            for (std::size_t i = 0; i <= old->mask; ++i)
+            {
+                entry* e = old->slots[i].load(std::memory_order_relaxed);
+                if (!IsEntry(e)) continue;
+                std::size_t j = e->hash & fresh->mask;
+                while (fresh->slots[j].load(std::memory_order_relaxed) != nullptr) j = (j + 1) & fresh->mask;
+                fresh->slots[j].store(e, std::memory_order_relaxed);
+            }
+            current.store(fresh, std::memory_order_release);
+            epoch_domain::Global().Retire(old);
+            tombstones = 0;
+            clock_hand = 0;
+            return fresh;
+        }
+
+        std::atomic<table*> current{nullptr};
+        std::size_t max_cache_size;
+        std::size_t slot_count = 0;
+
+        // Writer state, guarded by write_lock
+        mutable std::mutex write_lock;
+        std::size_t size = 0;
+        std::size_t tombstones = 0;
+        std::size_t clock_hand = 0;
+    };
+} // namespace caches
+
+#endif
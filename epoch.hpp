@@ -0,0 +1,193 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace caches
+{
+    /*
+     * Epoch-based reclamation. Readers wrap every access to shared,
+     * lock-free structures in an epoch_domain::guard; writers unlink an
+     * object first and then Retire() it instead of deleting it. A retired
+     * object is destroyed once no guard that could still see it is alive,
+     * i.e. once every pinned thread has entered a later epoch.
+     * Pinning is a store into the thread's own cache line, so readers never
+     * write shared memory. There is one domain per process (Global()); each
+     * thread that pins takes one of max_threads slots until it exits.
+     */
+    class epoch_domain
+    {
+        struct thread_state;
+
+    public:
+        static constexpr std::size_t max_threads = 1024;
+
+        static epoch_domain& Global()
+        {
+            static epoch_domain domain;
+            return domain;
+        }
+
+        epoch_domain(const epoch_domain&) = delete;
+        epoch_domain& operator=(const epoch_domain&) = delete;
+
+        // Whatever is still retired at exit has no readers left
+        ~epoch_domain()
+        {
+            for (const auto& item : retired) item.destroy(item.object);
+        }
+
+        // Pins the calling thread to the current epoch; guards nest
+        class guard
+        {
+        public:
+            explicit guard(epoch_domain& domain = Global()) : local{domain.Local()}
+            {
+                if (local.depth++ == 0)
+                {
+                    local.owned->epoch.store(domain.global_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    // The pin must be visible before any protected pointer is read
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                }
+            }
+
+            guard(const guard&) = delete;
+            guard& operator=(const guard&) = delete;
+
+            ~guard()
+            {
+                if (--local.depth == 0) local.owned->epoch.store(idle, std::memory_order_release);
+            }
+
+        private:
+            thread_state& local;
+        };
+
+        /*
+         * Destroys `object` with destroy(object) once no current guard can
+         * reach it. The caller must have unlinked it already.
+         */
+        void Retire(void* object, void (*destroy)(void*))
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst); // order the unlink before reading the epoch
+            std::vector<retired_object> ready;
+            {
+                std::lock_guard<std::mutex> lock{retire_lock};
+                retired.push_back({object, destroy, global_epoch.load(std::memory_order_relaxed)});
+                if (retired.size() < reclaim_batch) return;
+                ready = Collect();
+            }
+            for (const auto& item : ready) item.destroy(item.object);
+        }
+
+        template <typename T>
+        void Retire(T* object)
+        {
+            Retire(object, [](void* p) { delete static_cast<T*>(p); });
+        }
+
+        // Destroys every retired object that no guard can reach; returns how many
+        std::size_t Reclaim()
+        {
+            std::vector<retired_object> ready;
+            {
+                std::lock_guard<std::mutex> lock{retire_lock};
+                ready = Collect();
+            }
+            for (const auto& item : ready) item.destroy(item.object);
+            return ready.size();
+        }
+
+    private:
+        static constexpr std::uint64_t idle = 0;
+        static constexpr std::size_t reclaim_batch = 64;
+
+        struct alignas(64) slot
+        {
+            std::atomic<std::uint64_t> epoch{idle}; // epoch pinned, or idle
+            std::atomic<bool> taken{false};
+        };
+
+        struct retired_object
+        {
+            void* object;
+            void (*destroy)(void*);
+            std::uint64_t epoch;
+        };
+
+        epoch_domain() = default;
+
+        // Releases the thread's slot when it exits
+        struct thread_state
+        {
+            slot* owned = nullptr;
+            unsigned depth = 0;
+
+            ~thread_state()
+            {
+                if (owned != nullptr) owned->taken.store(false, std::memory_order_release);
+            }
+        };
+
+        thread_state& Local()
+        {
+            static thread_local thread_state state;
+            if (state.owned == nullptr)
+            {
+                for (std::size_t i = 0; i < max_threads; ++i)
+                {
+                    bool expected = false;
+                    if (!slots[i].taken.load(std::memory_order_relaxed) &&
+                        slots[i].taken.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    {
+                        state.owned = &slots[i];
+                        std::size_t seen = slots_in_use.load(std::memory_order_relaxed);
+                        while (seen <= i && !slots_in_use.compare_exchange_weak(seen, i + 1, std::memory_order_seq_cst)) {}
+                        break;
+                    }
+                }
+                if (state.owned == nullptr)
+                {
+                    throw std::runtime_error{"More threads than epoch_domain::max_threads."};
+                }
+            }
+            return state;
+        }
+
+        // Opens a new epoch and takes out what every pinned thread is past
+        std::vector<retired_object> Collect()
+        {
+            global_epoch.fetch_add(1, std::memory_order_seq_cst);
+
+            std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+            const std::size_t in_use = slots_in_use.load(std::memory_order_seq_cst);
+            for (std::size_t i = 0; i < in_use; ++i)
+            {
+                const std::uint64_t pinned = slots[i].epoch.load(std::memory_order_seq_cst);
+                if (pinned != idle) oldest = std::min(oldest, pinned);
+            }
+
+            const auto reachable = std::partition(retired.begin(), retired.end(),
+                                                  [oldest](const retired_object& item) { return item.epoch >= oldest; });
+            std::vector<retired_object> ready(reachable, retired.end());
+            retired.erase(reachable, retired.end());
+            return ready;
+        }
+
+        std::array<slot, max_threads> slots{};
+        std::atomic<std::size_t> slots_in_use{0}; // slots past this one were never taken
+        std::atomic<std::uint64_t> global_epoch{1};
+        std::mutex retire_lock;
+        std::vector<retired_object> retired;
+    };
+} // namespace caches
+
+#endif
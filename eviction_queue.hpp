@@ -0,0 +1,226 @@
+#ifndef EVICTION_QUEUE_HPP
+#define EVICTION_QUEUE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+    // What eviction_queue::Push does when the ring is full
+    enum class eviction_overflow
+    {
+        deliver, // drain a batch on the evicting thread, so nothing is lost
+        drop     // discard the new entry and count it in Dropped()
+    };
+
+    /*
+     * Bounded ring buffer that takes evicted entries off the cache's hot path.
+     * Plug Sink() into the OnErase slot of fixed_sized_cache / sharded_cache:
+     * an eviction then only moves the value into the ring, and the handler
+     * sees the entries later in batches, either from DrainEvictions() /
+     * Drain() or from a background thread started with StartDrainer().
+     * Batches are delivered one at a time, in eviction order. The queue must
+     * outlive every cache holding its sink, and the handler must not evict
+     * into the same queue.
+     * Key - Type of the key (copied from the cache)
+     * Value - Type of value (moved out of the cache)
+     */
+    template <typename Key, typename Value>
+    class eviction_queue
+    {
+    public:
+        using entry = std::pair<Key, Value>;
+        using batch_handler = std::function<void(std::vector<entry>& batch)>;
+
+        // Erase callback for the cache's OnErase slot; cheap to copy
+        class sink
+        {
+        public:
+            explicit sink(eviction_queue* queue) noexcept : queue{queue} {}
+
+            void operator()(const Key& key, Value&& value) const { queue->Push(key, std::move(value)); }
+            void operator()(const Key& key, const Value& value) const { queue->Push(key, Value(value)); }
+
+            std::size_t Drain() const { return queue->Drain(); }
+
+        private:
+            eviction_queue* queue;
+        };
+
+        /*
+         * Constructor
+         * capacity - Entries the ring holds before Push overflows
+         * handler - Receives each drained batch; it may move entries out.
+         *           Exceptions propagate out of Drain, but must not escape
+         *           on the background drainer.
+         * overflow - What to do when the ring is full
+         */
+        eviction_queue(std::size_t capacity, batch_handler handler,
+                       eviction_overflow overflow = eviction_overflow::deliver)
+            : ring(capacity), handler{std::move(handler)}, overflow{overflow}
+        {
+            if (capacity == 0)
+            {
+                throw std::invalid_argument{"Eviction queue capacity must be greater than zero."};
+            }
+            if (!this->handler)
+            {
+                throw std::invalid_argument{"Eviction queue needs a batch handler."};
+            }
+            batch.reserve(capacity);
+        }
+
+        eviction_queue(const eviction_queue&) = delete;
+        eviction_queue& operator=(const eviction_queue&) = delete;
+
+        // Stops the drainer and delivers whatever is left
+        ~eviction_queue()
+        {
+            StopDrainer();
+            Drain();
+        }
+
+        sink Sink() noexcept { return sink{this}; }
+
+        void Push(const Key& key, Value&& value)
+        {
+            std::unique_lock<std::mutex> guard{lock};
+            while (count == ring.size())
+            {
+                if (overflow == eviction_overflow::drop)
+                {
+                    ++dropped;
+                    return;
+                }
+                guard.unlock();
+                Drain();
+                guard.lock();
+            }
+
+            ring[(head + count) % ring.size()].emplace(key, std::move(value));
+            ++count;
+            if (count == ring.size() / 2 + 1)
+            {
+                wake.notify_one();
+            }
+        }
+
+        // Hands up to max queued entries to the handler as one batch;
+        // returns how many it delivered
+        std::size_t Drain(std::size_t max = ~std::size_t{0})
+        {
+            std::lock_guard<std::mutex> delivering{drain_lock};
+            {
+                std::lock_guard<std::mutex> guard{lock};
+                const std::size_t taken = std::min(count, max);
+                for (std::size_t i = 0; i < taken; ++i)
+                {
+                    auto& slot = ring[head];
+                    batch.push_back(std::move(*slot));
+                    slot.reset();
+                    head = (head + 1) % ring.size();
+                }
+                count -= taken;
+            }
+
+            const std::size_t delivered = batch.size();
+            if (delivered != 0)
+            {
+                try
+                {
+                    handler(batch);
+                }
+                catch (...)
+                {
+                    batch.clear();
+                    throw;
+                }
+                batch.clear();
+            }
+            return delivered;
+        }
+
+        /*
+         * Starts a thread that drains whenever the ring is more than half
+         * full, and at least every `interval` while entries are waiting.
+         */
+        void StartDrainer(std::chrono::milliseconds interval)
+        {
+            std::lock_guard<std::mutex> guard{lock};
+            if (drainer.joinable())
+            {
+                throw std::logic_error{"Eviction drainer already running."};
+            }
+            stopping = false;
+            drainer = std::thread{[this, interval] { RunDrainer(interval); }};
+        }
+
+        // Joins the drainer thread, if any; queued entries stay queued
+        void StopDrainer()
+        {
+            {
+                std::lock_guard<std::mutex> guard{lock};
+                if (!drainer.joinable()) return;
+                stopping = true;
+            }
+            wake.notify_one();
+            drainer.join();
+        }
+
+        // Entries waiting to be drained
+        std::size_t Pending() const
+        {
+            std::lock_guard<std::mutex> guard{lock};
+            return count;
+        }
+
+        // Entries discarded because the ring was full (eviction_overflow::drop)
+        std::uint64_t Dropped() const
+        {
+            std::lock_guard<std::mutex> guard{lock};
+            return dropped;
+        }
+
+    private:
+        void RunDrainer(std::chrono::milliseconds interval)
+        {
+            std::unique_lock<std::mutex> guard{lock};
+            while (!stopping)
+            {
+                wake.wait_for(guard, interval, [this] { return stopping || count > ring.size() / 2; });
+                if (count == 0) continue;
+
+                guard.unlock();
+                Drain();
+                guard.lock();
+            }
+        }
+
+        std::vector<std::optional<entry>> ring;
+        std::size_t head = 0;
+        std::size_t count = 0;
+        std::uint64_t dropped = 0;
+        mutable std::mutex lock;          // guards the ring and the drainer state
+        std::condition_variable wake;
+
+        std::mutex drain_lock;            // one batch at a time, in order
+        std::vector<entry> batch;
+        batch_handler handler;
+        eviction_overflow overflow;
+
+        std::thread drainer;
+        bool stopping = false;
+    };
+} // namespace caches
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef EXPIRING_CACHE_HPP
+#define EXPIRING_CACHE_HPP
+
+#include "cache.hpp"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+    /*
+     * Fixed-size cache whose entries can expire.
+     * Every entry has a deadline (a per-entry TTL or the cache's default TTL;
+     * a zero TTL means it never expires). Expired entries are invisible to
+     * TryGet/Get/Cached and are reclaimed in three ways:
+     *   - lazily, when a lookup finds them;
+     *   - by an incremental sweep over expiration buckets that every
+     *     operation runs with a bounded budget (or Sweep() explicitly);
+     *   - ahead of the policy: inserting into a full cache reclaims an
+     *     expired entry, if there is one, before the policy evicts a live one.
+     * Key - Type of the key (must be hashable)
+     * Value - Type of value
+     * Policy - Eviction policy for live entries
+     * Clock - Time source with a static now() (default: steady_clock)
+     */
+    template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
+              typename Clock = std::chrono::steady_clock>
+    class expiring_cache
+    {
+    public:
+        using clock_type = Clock;
+        using duration = typename Clock::duration;
+        using time_point = typename Clock::time_point;
+        using on_erase_cb = typename std::function<void(const Key&, const Value&)>;
+
+        /*
+         * Constructor
+         * max_size - Maximum number of elements in the cache
+         * default_ttl - TTL for Put without one; zero means no expiry
+         * policy - Eviction policy to be used
+         * on_erase - Optional callback when an item is evicted or expires
+         * resolution - Width of one expiration bucket; deadlines are rounded
+         *              up to it, so entries may outlive their TTL by that much
+         *              before the sweep (not lookups) reclaims them
+         * sweep_budget - Expired entries the sweep reclaims per operation
+         */
+        explicit expiring_cache(
+            size_t max_size,
+            duration default_ttl = duration::zero(),
+            const Policy<Key>& policy = Policy<Key>{},
+            on_erase_cb on_erase = [](const Key&, const Value&) {},
+            duration resolution = std::chrono::seconds{1},
+            std::size_t sweep_budget = 8)
+            : cache{max_size, policy,
+                    [this, on_erase](const Key& key, const timed_value& entry) {
+                        Unlink(entry);
+                        on_erase(key, entry.value);
+                    }},
+              max_cache_size{max_size},
+              default_ttl{default_ttl},
+              bucket_width{resolution},
+              sweep_budget{sweep_budget}
+        {
+            if (bucket_width <= duration::zero())
+            {
+                throw std::invalid_argument{"Expiration resolution must be positive."};
+            }
+        }
+
+        // The erase callback points back at this cache
+        expiring_cache(const expiring_cache&) = delete;
+        expiring_cache& operator=(const expiring_cache&) = delete;
+
+        // Adds or updates an entry with the default TTL
+        void Put(const Key& key, const Value& value) { Put(key, value, default_ttl); }
+
+        // Adds or updates an entry that expires after ttl (zero: never)
+        void Put(const Key& key, const Value& value, duration ttl)
+        {
+            const time_point now = Clock::now();
+            SweepExpired(now, sweep_budget);
+
+            // Prefer an expired slot over the policy's victim
+            if (cache.Size() >= max_cache_size && !cache.Peek(key).second)
+            {
+                ReclaimOneExpired(now);
+            }
+
+            // A TTL reaching past time_point::max() never expires
+            const time_point deadline =
+                ttl > duration::zero() && ttl < time_point::max() - now ? now + ttl : time_point::max();
+            const bucket_id bucket = deadline != time_point::max() ? BucketOf(deadline) : 0;
+
+            // An update within the same bucket keeps its slot; otherwise
+            // the old slot is freed and a new one taken
+            const auto existing = cache.Peek(key);
+            if (existing.second && existing.first->second.Expires() && existing.first->second.bucket == bucket)
+            {
+                cache.Put(key, timed_value{value, deadline, bucket, existing.first->second.slot});
+                return;
+            }
+            if (existing.second) Unlink(existing.first->second);
+
+            cache.Put(key, timed_value{value, deadline, bucket, 0});
+            if (deadline != time_point::max())
+            {
+                std::vector<Key>& keys = expiration_buckets[bucket];
+                keys.push_back(key);
+                cache.Peek(key).first->second.slot = keys.size() - 1;
+            }
+        }
+
+        // Try to get element by key; returns pair<value pointer, found>
+        std::pair<const Value*, bool> TryGet(const Key& key)
+        {
+            const time_point now = Clock::now();
+            SweepExpired(now, sweep_budget);
+
+            auto peeked = cache.Peek(key);
+            if (!peeked.second)
+            {
+                return {nullptr, false};
+            }
+            if (peeked.first->second.expires_at <= now)
+            {
+                cache.Remove(key);
+                return {nullptr, false};
+            }
+
+            auto result = cache.TryGet(key); // counts the hit for the policy
+            return {&result.first->second.value, true};
+        }
+
+        // Get value by key, throws if key not found or expired
+        const Value& Get(const Key& key)
+        {
+            auto result = TryGet(key);
+            if (!result.second)
+            {
+                throw std::range_error("Key not found in cache.");
+            }
+            return *result.first;
+        }
+
+        // Check if a live (unexpired) entry exists
+        bool Cached(const Key& key) const
+        {
+            auto peeked = cache.Peek(key);
+            return peeked.second && peeked.first->second.expires_at > Clock::now();
+        }
+
+        // Time left before key expires; duration::max() if it never does,
+        // zero if it is missing or already expired
+        duration TimeToLive(const Key& key) const
+        {
+            auto peeked = cache.Peek(key);
+            if (!peeked.second) return duration::zero();
+
+            const time_point deadline = peeked.first->second.expires_at;
+            if (deadline == time_point::max()) return duration::max();
+
+            const time_point now = Clock::now();
+            return deadline > now ? deadline - now : duration::zero();
+        }
+
+        // Entries held, including expired ones not reclaimed yet
+        std::size_t Size() const noexcept { return cache.Size(); }
+
+        // Remove a key, return true if it existed
+        bool Remove(const Key& key) { return cache.Remove(key); }
+
+        // Remove everything
+        void Clear()
+        {
+            cache.Clear();
+            expiration_buckets.clear();
+        }
+
+        // Reclaim at most max_entries expired entries; returns how many
+        // were removed
+        std::size_t Sweep(std::size_t max_entries)
+        {
+            return SweepExpired(Clock::now(), max_entries);
+        }
+
+    private:
+        using bucket_id = typename duration::rep;
+
+        struct timed_value
+        {
+            Value value;
+            time_point expires_at;
+            bucket_id bucket;         // expiration bucket, if it expires
+            mutable std::size_t slot; // index in that bucket, moved by Unlink
+
+            bool Expires() const noexcept { return expires_at != time_point::max(); }
+        };
+
+        // Buckets are keyed by the end of their time window, rounded up
+        bucket_id BucketOf(time_point deadline) const
+        {
+            const auto since_epoch = deadline.time_since_epoch();
+            return since_epoch / bucket_width + (since_epoch % bucket_width != duration::zero() ? 1 : 0);
+        }
+
+        bool BucketDue(bucket_id id, time_point now) const
+        {
+            return id <= now.time_since_epoch() / bucket_width;
+        }
+
+        /*
+         * Every entry with a deadline sits in exactly one bucket slot: the
+         * erase callback unlinks it however it leaves the cache (expiry,
+         * eviction, Remove), and Put moves it when its bucket changes.
+         * Bucket memory is therefore bounded by the capacity, and every
+         * entry of a due bucket has expired.
+         */
+        void Unlink(const timed_value& entry)
+        {
+            if (!entry.Expires()) return;
+
+            const auto bucket = expiration_buckets.find(entry.bucket);
+            std::vector<Key>& keys = bucket->second;
+            if (entry.slot + 1 != keys.size())
+            {
+                keys[entry.slot] = std::move(keys.back());
+                cache.Peek(keys[entry.slot]).first->second.slot = entry.slot;
+            }
+            keys.pop_back();
+            if (keys.empty()) expiration_buckets.erase(bucket);
+        }
+
+        // Removes the last entry of the earliest bucket, if it is due
+        bool ReclaimOneExpired(time_point now)
+        {
+            if (expiration_buckets.empty()) return false;
+
+            const auto bucket = expiration_buckets.begin();
+            if (!BucketDue(bucket->first, now)) return false;
+
+            const Key key = bucket->second.back(); // Remove unlinks, and so destroys, the slot
+            cache.Remove(key);
+            return true;
+        }
+
+        std::size_t SweepExpired(time_point now, std::size_t budget)
+        {
+            std::size_t reclaimed = 0;
+            while (reclaimed < budget && ReclaimOneExpired(now))
+            {
+                ++reclaimed;
+            }
+            return reclaimed;
+        }
+
+        fixed_sized_cache<Key, timed_value, Policy, std::unordered_map<Key, timed_value>> cache;
+        std::map<bucket_id, std::vector<Key>> expiration_buckets;
+        std::size_t max_cache_size;
+        duration default_ttl;
+        duration bucket_width;
+        std::size_t sweep_budget;
+    };
+} // namespace caches
+
+#endif
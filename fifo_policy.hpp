@@ -2,8 +2,8 @@
 #define FIFO_CACHE_POLICY_HPP
 
 #include "cache_policy.hpp"
-#include <list>
-#include <unordered_map>
+#include "key_pool.hpp"
+#include <memory>
 #include <stdexcept>
 
 namespace caches
@@ -11,47 +11,79 @@ namespace caches
     /**
      * FIFO (First-In, First-Out) Cache Policy
      * Oldest inserted element is removed first when cache is full.
+     * Allocator allocates the key nodes and their index (see key_pool).
      */
-    template <typename Key>
-    class FIFOCachePolicy : public ICachePolicy<Key>
+    template <typename Key, typename Allocator = std::allocator<Key>>
+    class BasicFIFOCachePolicy
     {
+        using pool = key_pool<Key, Allocator>;
+
     public:
-        using fifo_iterator = typename std::list<Key>::const_iterator;
+        using node_id = typename pool::index_type;
+
+        BasicFIFOCachePolicy() = default;
+        explicit BasicFIFOCachePolicy(const Allocator& alloc) : key_nodes{alloc} {}
+        ~BasicFIFOCachePolicy() noexcept = default;
+
+        void Reserve(std::size_t capacity) {
+            key_nodes.reserve(capacity);
+        }
 
-        FIFOCachePolicy() = default;
-        ~FIFOCachePolicy() noexcept override = default;
+        void Insert(const Key& key) { Insert(key, key_hash(key)); }
+        void Erase(const Key& key) noexcept { Erase(key, key_hash(key)); }
 
-        void Insert(const Key& key) override {
-            if (key_lookup.find(key) != key_lookup.end()) return; // avoid duplicates
+        // Same, with hash == key_hash(key) supplied by the cache
+        void Insert(const Key& key, std::uint64_t hash) {
+            if (key_nodes.find(key, hash) != pool::npos) return; // avoid duplicates
 
-            fifo_queue.emplace_front(key);
-            key_lookup[key] = fifo_queue.begin();
+            key_nodes.push_front(fifo_queue, key_nodes.insert(key, hash));
         }
 
-        void Touch(const Key& key) noexcept override {
+        void Touch(const Key& key) noexcept {
             // FIFO does not care about accesses
             (void)key;
         }
 
-        void Erase(const Key& key) noexcept override {
-            auto it = key_lookup.find(key);
-            if (it == key_lookup.end()) return; // key not found
+        void Touch(const Key& key, std::uint64_t hash) noexcept {
+            (void)key;
+            (void)hash;
+        }
+
+        void Erase(const Key& key, std::uint64_t hash) noexcept {
+            const node_id id = key_nodes.find(key, hash);
+            if (id == pool::npos) return; // key not found
 
-            fifo_queue.erase(it->second);
-            key_lookup.erase(it);
+            key_nodes.unlink(fifo_queue, id);
+            key_nodes.erase(id);
         }
 
-        const Key& ReplacementCandidate() const override {
-            if (fifo_queue.empty()) {
+        const Key& ReplacementCandidate() const {
+            if (fifo_queue.size == 0) {
                 throw std::runtime_error("No keys available for eviction (FIFO).");
             }
-            return fifo_queue.back(); // oldest inserted
+            return key_nodes.key(fifo_queue.tail); // oldest inserted
+        }
+
+        // Keys oldest first: inserting them in this order rebuilds the queue
+        template <typename Visit>
+        void ForEach(Visit&& visit) const {
+            for (node_id id = fifo_queue.tail; id != pool::npos; id = key_nodes.prev(id)) {
+                visit(key_nodes.key(id));
+            }
+        }
+
+        // Heap bytes of the policy: key nodes, their copies of the keys and the index
+        std::size_t MemoryUsage() const noexcept {
+            return key_nodes.memory_usage();
         }
 
     private:
-        std::list<Key> fifo_queue;
-        std::unordered_map<Key, fifo_iterator> key_lookup;
+        pool key_nodes;
+        typename pool::list fifo_queue; // head is the newest key
     };
+
+    template <typename Key>
+    using FIFOCachePolicy = BasicFIFOCachePolicy<Key>;
 }
 
-#endif 
+#endif
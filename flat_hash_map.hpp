@@ -0,0 +1,744 @@
+#ifndef FLAT_HASH_MAP_HPP
+#define FLAT_HASH_MAP_HPP
+
+#include "hash_util.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CACHES_FLAT_MAP_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace caches
+{
+    namespace detail
+    {
+        // Control byte states; a full slot stores the low 7 bits of its hash
+        constexpr std::int8_t ctrl_empty = -128;  // 0b10000000
+        constexpr std::int8_t ctrl_deleted = -2;  // 0b11111110
+        constexpr std::size_t group_width = 16;
+
+        // Makes T depend on K, so SFINAE on T's members happens per call
+        template <typename T, typename K>
+        struct dependent_type
+        {
+            using type = T;
+        };
+
+        // Bit i set for every matching control byte of a 16-byte group
+        class group_mask
+        {
+        public:
+            explicit group_mask(std::uint32_t bits) noexcept : bits{bits} {}
+
+            explicit operator bool() const noexcept { return bits != 0; }
+            std::size_t lowest() const noexcept
+            {
+#if defined(_MSC_VER) && !defined(__clang__)
+                unsigned long index;
+                _BitScanForward(&index, bits);
+                return static_cast<std::size_t>(index);
+#else
+                return static_cast<std::size_t>(__builtin_ctz(bits));
+#endif
+            }
+            void clear_lowest() noexcept { bits &= bits - 1; }
+            // Only the bits also set in `keep` (e.g. the first n bytes of a group)
+            group_mask masked(std::uint32_t keep) const noexcept { return group_mask{bits & keep}; }
+
+        private:
+            std::uint32_t bits;
+        };
+
+        // One group of control bytes, compared with a single SIMD instruction
+        class ctrl_group
+        {
+        public:
+            explicit ctrl_group(const std::int8_t* ctrl) noexcept
+            {
+#ifdef CACHES_FLAT_MAP_SSE2
+                bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+                std::memcpy(bytes, ctrl, group_width);
+#endif
+            }
+
+            group_mask match(std::int8_t h2) const noexcept
+            {
+#ifdef CACHES_FLAT_MAP_SSE2
+                return group_mask{static_cast<std::uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2))))};
+#else
+                return scalar_match([h2](std::int8_t c) { return c == h2; });
+#endif
+            }
+
+            group_mask match_empty() const noexcept
+            {
+#ifdef CACHES_FLAT_MAP_SSE2
+                return match(ctrl_empty);
+#else
+                return scalar_match([](std::int8_t c) { return c == ctrl_empty; });
+#endif
+            }
+
+            // Empty and deleted are the only states with the sign bit set
+            group_mask match_empty_or_deleted() const noexcept
+            {
+#ifdef CACHES_FLAT_MAP_SSE2
+                return group_mask{static_cast<std::uint32_t>(_mm_movemask_epi8(bytes))};
+#else
+                return scalar_match([](std::int8_t c) { return c < 0; });
+#endif
+            }
+
+        private:
+#ifdef CACHES_FLAT_MAP_SSE2
+            __m128i bytes;
+#else
+            template <typename Pred>
+            group_mask scalar_match(Pred pred) const noexcept
+            {
+                std::uint32_t bits = 0;
+                for (std::size_t i = 0; i < group_width; ++i)
+                {
+                    if (pred(bytes[i])) bits |= 1u << i;
+                }
+                return group_mask{bits};
+            }
+
+            std::int8_t bytes[group_width];
+#endif
+        };
+    } // namespace detail
+
+    /*
+     * Transparent hasher for std::string keys: with std::equal_to<> it lets a
+     * flat_hash_map<std::string, V> be searched by std::string_view or
+     * const char* without building a temporary std::string.
+     */
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(std::string_view str) const noexcept
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    /*
+     * Open-addressing hash map in the style of Swiss tables.
+     * Slots are split into aligned groups of 16 control bytes; a lookup probes
+     * whole groups, matching 7 bits of the hash against all 16 bytes at once
+     * and touching the slot array only for candidates. Values are stored
+     * inline, so there is no per-entry allocation. The subset of the
+     * std::unordered_map interface used by fixed_sized_cache is provided.
+     * Call reserve() up front: a map that stays within its reservation never
+     * reallocates, tombstones left by erase are purged in place.
+     * Key - Type of the key (must be hashable)
+     * Value - Type of value
+     * Hash / KeyEqual - Hasher and equality; the hash is remixed internally.
+     *                   When both define is_transparent, find/count/erase also
+     *                   accept any key type they can compare.
+     * Allocator - Allocates the slot array and the control bytes (rebound)
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>,
+              typename KeyEqual = std::equal_to<Key>,
+              typename Allocator = std::allocator<std::pair<const Key, Value>>>
+    class flat_hash_map
+    {
+        // Slots hold a mutable pair so rehashing can move keys; callers only
+        // ever see the const-key view (the same trick node-less Swiss tables use)
+        union slot_type
+        {
+            slot_type() noexcept {}
+            ~slot_type() {}
+
+            std::pair<const Key, Value> value;
+            std::pair<Key, Value> mutable_value;
+        };
+
+        template <bool IsConst>
+        class iterator_impl
+        {
+            friend class flat_hash_map;
+            friend class iterator_impl<!IsConst>;
+            using ctrl_ptr = const std::int8_t*;
+            using slot_ptr = std::conditional_t<IsConst, const slot_type*, slot_type*>;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<const Key, Value>;
+            using difference_type = std::ptrdiff_t;
+            using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+            using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+            iterator_impl() = default;
+
+            // iterator converts to const_iterator
+            template <bool C = IsConst, typename = std::enable_if_t<C>>
+            iterator_impl(const iterator_impl<false>& other) noexcept
+                : ctrl{other.ctrl}, slot{other.slot}, ctrl_end{other.ctrl_end}
+            {
+            }
+
+            reference operator*() const noexcept { return slot->value; }
+            pointer operator->() const noexcept { return &slot->value; }
+
+            iterator_impl& operator++() noexcept
+            {
+                ++ctrl;
+                ++slot;
+                SkipFree();
+                return *this;
+            }
+
+            iterator_impl operator++(int) noexcept
+            {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            bool operator==(const iterator_impl& other) const noexcept { return ctrl == other.ctrl; }
+            bool operator!=(const iterator_impl& other) const noexcept { return ctrl != other.ctrl; }
+
+        private:
+            iterator_impl(ctrl_ptr ctrl, slot_ptr slot, ctrl_ptr ctrl_end) noexcept
+                : ctrl{ctrl}, slot{slot}, ctrl_end{ctrl_end}
+            {
+            }
+
+            void SkipFree() noexcept
+            {
+                while (ctrl != ctrl_end && *ctrl < 0)
+                {
+                    ++ctrl;
+                    ++slot;
+                }
+            }
+
+            ctrl_ptr ctrl = nullptr;
+            slot_ptr slot = nullptr;
+            ctrl_ptr ctrl_end = nullptr;
+        };
+
+        // Enables the heterogeneous overloads for keys other than Key itself
+        template <typename K>
+        using transparent_key = std::enable_if_t<
+            !std::is_same_v<std::decay_t<K>, Key>,
+            std::void_t<typename detail::dependent_type<Hash, K>::type::is_transparent,
+                        typename detail::dependent_type<KeyEqual, K>::type::is_transparent>>;
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+        using value_type = std::pair<const Key, Value>;
+        using size_type = std::size_t;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+        using allocator_type = Allocator;
+        using iterator = iterator_impl<false>;
+        using const_iterator = iterator_impl<true>;
+
+        flat_hash_map() = default;
+
+        explicit flat_hash_map(const Allocator& allocator) : alloc{allocator} {}
+
+        explicit flat_hash_map(size_type capacity, const Allocator& allocator = Allocator{}) : alloc{allocator}
+        {
+            reserve(capacity);
+        }
+
+        flat_hash_map(const flat_hash_map& other)
+            : hash_fn{other.hash_fn},
+              equal_fn{other.equal_fn},
+              alloc{alloc_traits::select_on_container_copy_construction(other.alloc)}
+        {
+            reserve(other.size());
+            for (const auto& kv : other)
+            {
+                try_emplace(kv.first, kv.second);
+            }
+        }
+
+        flat_hash_map(flat_hash_map&& other) noexcept
+            : ctrl{std::exchange(other.ctrl, nullptr)},
+              slots{std::exchange(other.slots, nullptr)},
+              slot_count{std::exchange(other.slot_count, 0)},
+              live_count{std::exchange(other.live_count, 0)},
+              deleted_count{std::exchange(other.deleted_count, 0)},
+              hash_fn{std::move(other.hash_fn)},
+              equal_fn{std::move(other.equal_fn)},
+              alloc{other.alloc}
+        {
+        }
+
+        flat_hash_map& operator=(flat_hash_map other)
+        {
+            // Storage from an allocator that stays behind (e.g. a different
+            // memory resource) can't be adopted; move the entries instead
+            if constexpr (!alloc_traits::propagate_on_container_swap::value && !alloc_traits::is_always_equal::value)
+            {
+                if (!(alloc == other.alloc))
+                {
+                    clear();
+                    reserve(other.size());
+                    for (auto& kv : other) try_emplace(kv.first, std::move(kv.second));
+                    return *this;
+                }
+            }
+            swap(other);
+            return *this;
+        }
+
+        ~flat_hash_map() { Release(); }
+
+        // Like the standard containers, allocators that don't propagate on
+        // swap must compare equal
+        void swap(flat_hash_map& other) noexcept
+        {
+            using std::swap;
+            swap(ctrl, other.ctrl);
+            swap(slots, other.slots);
+            swap(slot_count, other.slot_count);
+            swap(live_count, other.live_count);
+            swap(deleted_count, other.deleted_count);
+            swap(hash_fn, other.hash_fn);
+            swap(equal_fn, other.equal_fn);
+            if constexpr (alloc_traits::propagate_on_container_swap::value) swap(alloc, other.alloc);
+        }
+
+        iterator begin() noexcept
+        {
+            iterator it{ctrl, slots, ctrl + slot_count};
+            it.SkipFree();
+            return it;
+        }
+
+        const_iterator begin() const noexcept
+        {
+            const_iterator it{ctrl, slots, ctrl + slot_count};
+            it.SkipFree();
+            return it;
+        }
+
+        iterator end() noexcept { return {ctrl + slot_count, slots + slot_count, ctrl + slot_count}; }
+        const_iterator end() const noexcept { return {ctrl + slot_count, slots + slot_count, ctrl + slot_count}; }
+        const_iterator cbegin() const noexcept { return begin(); }
+        const_iterator cend() const noexcept { return end(); }
+
+        size_type size() const noexcept { return live_count; }
+        bool empty() const noexcept { return live_count == 0; }
+
+        // Number of slots, the map holds at most 7/8 of it before growing
+        size_type capacity() const noexcept { return slot_count; }
+
+        hasher hash_function() const { return hash_fn; }
+        key_equal key_eq() const { return equal_fn; }
+        allocator_type get_allocator() const { return alloc; }
+
+        // Bytes allocated: the slot array, entries included, and the control bytes
+        size_type memory_usage() const noexcept { return slot_count * (sizeof(slot_type) + 1); }
+
+        // Make room for `count` entries without any further allocation
+        void reserve(size_type count)
+        {
+            if (count <= MaxLoad(slot_count)) return;
+
+            size_type wanted = detail::group_width;
+            while (MaxLoad(wanted) < count) wanted *= 2;
+            Resize(wanted);
+        }
+
+        iterator find(const Key& key) noexcept
+        {
+            const size_type pos = FindSlot(key);
+            return pos == npos ? end() : IteratorAt(pos);
+        }
+
+        const_iterator find(const Key& key) const noexcept
+        {
+            const size_type pos = FindSlot(key);
+            return pos == npos ? end() : ConstIteratorAt(pos);
+        }
+
+        size_type count(const Key& key) const noexcept { return FindSlot(key) == npos ? 0 : 1; }
+
+        template <typename K, typename = transparent_key<K>>
+        iterator find(const K& key) noexcept
+        {
+            const size_type pos = FindSlot(key, HashOf(key));
+            return pos == npos ? end() : IteratorAt(pos);
+        }
+
+        template <typename K, typename = transparent_key<K>>
+        const_iterator find(const K& key) const noexcept
+        {
+            const size_type pos = FindSlot(key, HashOf(key));
+            return pos == npos ? end() : ConstIteratorAt(pos);
+        }
+
+        template <typename K, typename = transparent_key<K>>
+        size_type count(const K& key) const noexcept
+        {
+            return FindSlot(key, HashOf(key)) == npos ? 0 : 1;
+        }
+
+        // Probe hash of key, for prefetch() and the find(key, hash) overloads,
+        // so a batch can hash every key before touching the table
+        template <typename K>
+        std::uint64_t hash(const K& key) const noexcept { return HashOf(key); }
+
+        // Starts loading the first group probed for `hash`
+        void prefetch(std::uint64_t hash) const noexcept
+        {
+            if (slot_count == 0) return;
+
+            const size_type base = (H1(hash) & GroupMask()) * detail::group_width;
+            prefetch_read(ctrl + base);
+            prefetch_read(slots + base);
+        }
+
+        // find with a hash obtained from hash(key)
+        iterator find(const Key& key, std::uint64_t hash) noexcept
+        {
+            const size_type pos = FindSlot(key, hash);
+            return pos == npos ? end() : IteratorAt(pos);
+        }
+
+        const_iterator find(const Key& key, std::uint64_t hash) const noexcept
+        {
+            const size_type pos = FindSlot(key, hash);
+            return pos == npos ? end() : ConstIteratorAt(pos);
+        }
+
+        // Inserts value_type(key, args...) unless key is already present
+        template <typename K, typename... Args>
+        std::pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+        {
+            const std::uint64_t hash = HashOf(key);
+            return try_emplace_hashed(hash, std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+        // try_emplace with a hash obtained from hash(key)
+        template <typename K, typename... Args>
+        std::pair<iterator, bool> try_emplace_hashed(std::uint64_t hash, K&& key, Args&&... args)
+        {
+            const size_type found = FindSlot(key, hash);
+            if (found != npos)
+            {
+                return {IteratorAt(found), false};
+            }
+
+            // The slot is only marked full once its element exists, so a
+            // throwing key or value constructor leaves the table unchanged
+            const size_type pos = PrepareInsert(hash);
+            ::new (static_cast<void*>(&slots[pos].mutable_value)) std::pair<Key, Value>(
+                std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...));
+            MarkFull(pos, hash);
+            return {IteratorAt(pos), true};
+        }
+
+        // Same as try_emplace: the first argument must be the key
+        template <typename K, typename... Args>
+        std::pair<iterator, bool> emplace(K&& key, Args&&... args)
+        {
+            return try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+        std::pair<iterator, bool> insert(const value_type& value)
+        {
+            return try_emplace(value.first, value.second);
+        }
+
+        Value& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+        iterator erase(const_iterator it) noexcept
+        {
+            const size_type pos = static_cast<size_type>(it.ctrl - ctrl);
+            EraseAt(pos);
+
+            iterator next{ctrl + pos, slots + pos, ctrl + slot_count};
+            next.SkipFree();
+            return next;
+        }
+
+        iterator erase(iterator it) noexcept { return erase(const_iterator{it}); }
+
+        size_type erase(const Key& key) noexcept
+        {
+            const size_type pos = FindSlot(key);
+            if (pos == npos) return 0;
+
+            EraseAt(pos);
+            return 1;
+        }
+
+        template <typename K, typename = transparent_key<K>>
+        size_type erase(const K& key) noexcept
+        {
+            const size_type pos = FindSlot(key, HashOf(key));
+            if (pos == npos) return 0;
+
+            EraseAt(pos);
+            return 1;
+        }
+
+        // Destroys every entry but keeps the storage
+        void clear() noexcept
+        {
+            for (size_type i = 0; i < slot_count; ++i)
+            {
+                if (ctrl[i] >= 0) slots[i].value.~value_type();
+            }
+            if (slot_count != 0)
+            {
+                std::memset(ctrl, static_cast<unsigned char>(detail::ctrl_empty), slot_count);
+            }
+            live_count = 0;
+            deleted_count = 0;
+        }
+
+    private:
+        static constexpr size_type npos = ~size_type{0};
+
+        static constexpr size_type MaxLoad(size_type slots) noexcept { return slots - slots / 8; }
+
+        template <typename K>
+        std::uint64_t HashOf(const K& key) const noexcept
+        {
+            return mix_hash(static_cast<std::uint64_t>(hash_fn(key)));
+        }
+
+        static std::int8_t H2(std::uint64_t hash) noexcept { return static_cast<std::int8_t>(hash & 0x7F); }
+        static size_type H1(std::uint64_t hash) noexcept { return static_cast<size_type>(hash >> 7); }
+
+        size_type GroupMask() const noexcept { return slot_count / detail::group_width - 1; }
+
+        // Groups are visited in triangular order, which covers every group
+        // exactly once for a power-of-two group count
+        template <typename Visit>
+        size_type Probe(std::uint64_t hash, Visit visit) const
+        {
+            const size_type mask = GroupMask();
+            size_type group = H1(hash) & mask;
+            for (size_type step = 1;; ++step)
+            {
+                const size_type result = visit(group * detail::group_width);
+                if (result != npos) return result;
+                group = (group + step) & mask;
+            }
+        }
+
+        size_type FindSlot(const Key& key) const noexcept { return FindSlot(key, HashOf(key)); }
+
+        template <typename K>
+        size_type FindSlot(const K& key, std::uint64_t hash) const noexcept
+        {
+            if (slot_count == 0) return npos;
+
+            constexpr size_type not_found = npos - 1;
+            const size_type result = Probe(hash, [&](size_type base) -> size_type {
+                const detail::ctrl_group group{ctrl + base};
+                for (auto match = group.match(H2(hash)); match; match.clear_lowest())
+                {
+                    const size_type pos = base + match.lowest();
+                    if (equal_fn(slots[pos].value.first, key)) return pos;
+                }
+                return group.match_empty() ? not_found : npos;
+            });
+            return result == not_found ? npos : result;
+        }
+
+        size_type FirstFree(std::uint64_t hash) const noexcept
+        {
+            return Probe(hash, [&](size_type base) -> size_type {
+                const auto free = detail::ctrl_group{ctrl + base}.match_empty_or_deleted();
+                return free ? base + free.lowest() : npos;
+            });
+        }
+
+        // Makes room and finds the slot for a new entry with `hash`
+        size_type PrepareInsert(std::uint64_t hash)
+        {
+            if (slot_count == 0)
+            {
+                Resize(detail::group_width);
+            }
+            else if (live_count + deleted_count >= MaxLoad(slot_count))
+            {
+                // Mostly tombstones: purge them in place instead of growing
+                if (live_count < MaxLoad(slot_count) / 2) PurgeDeleted();
+                else Resize(slot_count * 2);
+            }
+
+            return FirstFree(hash);
+        }
+
+        void MarkFull(size_type pos, std::uint64_t hash) noexcept
+        {
+            if (ctrl[pos] == detail::ctrl_deleted) --deleted_count;
+            ctrl[pos] = H2(hash);
+            ++live_count;
+        }
+
+        void EraseAt(size_type pos) noexcept
+        {
+            slots[pos].value.~value_type();
+            --live_count;
+
+            // Lookups only continue past groups that have no empty byte. If
+            // this group still has one, nobody probes through it and the slot
+            // can become empty again; otherwise leave a tombstone.
+            const size_type base = pos - pos % detail::group_width;
+            if (detail::ctrl_group{ctrl + base}.match_empty())
+            {
+                ctrl[pos] = detail::ctrl_empty;
+            }
+            else
+            {
+                ctrl[pos] = detail::ctrl_deleted;
+                ++deleted_count;
+            }
+        }
+
+        static void Transfer(slot_type& to, slot_type& from)
+        {
+            ::new (static_cast<void*>(&to.mutable_value)) std::pair<Key, Value>(std::move(from.mutable_value));
+            from.mutable_value.~pair();
+        }
+
+        void Resize(size_type new_slot_count)
+        {
+            std::int8_t* old_ctrl = ctrl;
+            slot_type* old_slots = slots;
+            const size_type old_slot_count = slot_count;
+
+            ctrl = CtrlAllocator{alloc}.allocate(new_slot_count);
+            std::memset(ctrl, static_cast<unsigned char>(detail::ctrl_empty), new_slot_count);
+            try
+            {
+                slots = SlotAllocator{alloc}.allocate(new_slot_count);
+            }
+            catch (...)
+            {
+                CtrlAllocator{alloc}.deallocate(ctrl, new_slot_count);
+                ctrl = old_ctrl;
+                throw;
+            }
+            slot_count = new_slot_count;
+            deleted_count = 0;
+
+            for (size_type i = 0; i < old_slot_count; ++i)
+            {
+                if (old_ctrl[i] < 0) continue;
+
+                const std::uint64_t hash = HashOf(old_slots[i].value.first);
+                const size_type pos = FirstFree(hash);
+                ctrl[pos] = H2(hash);
+                Transfer(slots[pos], old_slots[i]);
+            }
+
+            if (old_slot_count != 0)
+            {
+                CtrlAllocator{alloc}.deallocate(old_ctrl, old_slot_count);
+                SlotAllocator{alloc}.deallocate(old_slots, old_slot_count);
+            }
+        }
+
+        // Rehash at the same size without allocating: full slots are
+        // re-marked deleted, then each is moved to its first free position
+        void PurgeDeleted()
+        {
+            for (size_type i = 0; i < slot_count; ++i)
+            {
+                ctrl[i] = ctrl[i] >= 0 ? detail::ctrl_deleted : detail::ctrl_empty;
+            }
+
+            for (size_type i = 0; i < slot_count; ++i)
+            {
+                if (ctrl[i] != detail::ctrl_deleted) continue;
+
+                const std::uint64_t hash = HashOf(slots[i].value.first);
+                const size_type target = FirstFree(hash);
+
+                // Already in the first group with room for it: stay put
+                if (target / detail::group_width == i / detail::group_width)
+                {
+                    ctrl[i] = H2(hash);
+                    continue;
+                }
+
+                if (ctrl[target] == detail::ctrl_empty)
+                {
+                    Transfer(slots[target], slots[i]);
+                    ctrl[target] = H2(hash);
+                    ctrl[i] = detail::ctrl_empty;
+                }
+                else
+                {
+                    // Target holds another entry still waiting to be placed:
+                    // swap them and process slot i again
+                    slot_type tmp;
+                    Transfer(tmp, slots[target]);
+                    Transfer(slots[target], slots[i]);
+                    Transfer(slots[i], tmp);
+                    ctrl[target] = H2(hash);
+                    --i;
+                }
+            }
+            deleted_count = 0;
+        }
+
+        void Release() noexcept
+        {
+            if (slot_count == 0) return;
+
+            clear();
+            CtrlAllocator{alloc}.deallocate(ctrl, slot_count);
+            SlotAllocator{alloc}.deallocate(slots, slot_count);
+            ctrl = nullptr;
+            slots = nullptr;
+            slot_count = 0;
+        }
+
+        iterator IteratorAt(size_type pos) noexcept { return {ctrl + pos, slots + pos, ctrl + slot_count}; }
+
+        const_iterator ConstIteratorAt(size_type pos) const noexcept
+        {
+            return {ctrl + pos, slots + pos, ctrl + slot_count};
+        }
+
+        using alloc_traits = std::allocator_traits<Allocator>;
+        using SlotAllocator = typename alloc_traits::template rebind_alloc<slot_type>;
+        using CtrlAllocator = typename alloc_traits::template rebind_alloc<std::int8_t>;
+
+        std::int8_t* ctrl = nullptr;
+        slot_type* slots = nullptr;
+        size_type slot_count = 0;
+        size_type live_count = 0;
+        size_type deleted_count = 0;
+        Hash hash_fn;
+        KeyEqual equal_fn;
+        Allocator alloc;
+    };
+} // namespace caches
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef FRONT_CACHE_HPP
+#define FRONT_CACHE_HPP
+
+#include "hash_util.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace caches
+{
+    /*
+     * Puts a small, direct-mapped, per-thread front cache in front of a
+     * thread-safe cache (sharded_cache, concurrent_cache, ...). A front hit
+     * touches only the calling thread's table plus one read of a shared
+     * version counter, so hot keys are served from core-local memory
+     * without locks. Put / Remove / Clear go to the shared cache and then
+     * bump the version stripe of the key, which invalidates every thread's
+     * front copy of it. A front hit never returns a stale value, but it can
+     * return an entry the shared cache has since evicted, and it doesn't
+     * refresh the entry's recency in the shared cache's policy.
+     * Each thread allocates its table for a cache on first use and keeps it
+     * until the thread exits.
+     * Cache - Shared cache with TryGet(key) -> std::optional<Value>, Put,
+     *         Remove and Clear
+     * Entries - Front slots per thread (a power of two)
+     * Stripes - Version counters shared by all keys
+     */
+    template <typename Cache, std::size_t Entries = 256, std::size_t Stripes = 1024>
+    class front_cached
+    {
+        static_assert(Entries > 0 && (Entries & (Entries - 1)) == 0, "Entries must be a power of two.");
+        static_assert(Stripes > 0, "front_cached needs at least one version stripe.");
+
+    public:
+        using key_type = typename Cache::key_type;
+        using mapped_type = typename Cache::mapped_type;
+
+        // Arguments construct the shared cache
+        template <typename... Args>
+        explicit front_cached(Args&&... args)
+            : cache(std::forward<Args>(args)...), versions{new std::atomic<std::uint64_t>[Stripes]}, id{NextId()}
+        {
+            for (std::size_t i = 0; i < Stripes; ++i) versions[i].store(0, std::memory_order_relaxed);
+        }
+
+        front_cached(const front_cached&) = delete;
+        front_cached& operator=(const front_cached&) = delete;
+
+        std::optional<mapped_type> TryGet(const key_type& key)
+        {
+            const std::uint64_t hash = HashOf(key);
+            // Read the version before the shared cache, so a Put racing with
+            // the fill leaves the slot already out of date
+            const std::uint64_t version = versions[hash % Stripes].load(std::memory_order_acquire);
+            slot& s = Local().slots[hash & (Entries - 1)];
+            if (s.entry && s.version == version && std::equal_to<key_type>{}(s.entry->first, key))
+            {
+                return s.entry->second;
+            }
+
+            std::optional<mapped_type> value = cache.TryGet(key);
+            if (value)
+            {
+                s.entry.emplace(key, *value);
+                s.version = version;
+            }
+            return value;
+        }
+
+        void Put(const key_type& key, const mapped_type& value)
+        {
+            cache.Put(key, value);
+            Invalidate(key);
+        }
+
+        bool Remove(const key_type& key)
+        {
+            const bool removed = cache.Remove(key);
+            Invalidate(key);
+            return removed;
+        }
+
+        void Clear()
+        {
+            cache.Clear();
+            for (std::size_t i = 0; i < Stripes; ++i) versions[i].fetch_add(1, std::memory_order_release);
+        }
+
+        // Drops every thread's front copy of key; call after writing to
+        // Shared() directly
+        void Invalidate(const key_type& key)
+        {
+            versions[HashOf(key) % Stripes].fetch_add(1, std::memory_order_release);
+        }
+
+        // The shared cache, for everything else (Size, Statistics, ...)
+        Cache& Shared() noexcept { return cache; }
+        const Cache& Shared() const noexcept { return cache; }
+
+    private:
+        struct slot
+        {
+            std::optional<std::pair<key_type, mapped_type>> entry;
+            std::uint64_t version = 0;
+        };
+
+        struct table
+        {
+            std::array<slot, Entries> slots;
+        };
+
+        // This thread's tables, by cache id; the last one used is cached
+        struct thread_tables
+        {
+            std::uint64_t last_id = 0;
+            table* last = nullptr;
+            std::unordered_map<std::uint64_t, std::unique_ptr<table>> all;
+        };
+
+        static std::uint64_t HashOf(const key_type& key)
+        {
+            return mix_hash(static_cast<std::uint64_t>(std::hash<key_type>{}(key)));
+        }
+
+        static std::uint64_t NextId() noexcept
+        {
+            static std::atomic<std::uint64_t> next{1};
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        table& Local()
+        {
+            static thread_local thread_tables tables;
+            if (tables.last_id == id) return *tables.last;
+
+            auto& owned = tables.all[id];
+            if (!owned) owned = std::make_unique<table>();
+            tables.last_id = id;
+            tables.last = owned.get();
+            return *owned;
+        }
+
+        Cache cache;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> versions;
+        const std::uint64_t id; // unique per instance, unlike its address
+    };
+} // namespace caches
+
+#endif
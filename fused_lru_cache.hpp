@@ -0,0 +1,235 @@
+#ifndef FUSED_LRU_CACHE_HPP
+#define FUSED_LRU_CACHE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace caches
+{
+    /*
+     * Fixed-size LRU cache with the recency list fused into the value map.
+     * Every map entry carries its own prev/next links, so a hit is a single
+     * hash lookup plus one splice, instead of a lookup in the cache map and a
+     * second one in LRUCachePolicy's key_finder.
+     * Key - Type of the key (must be hashable)
+     * Value - Type of value
+     * Hash / KeyEqual - Hasher and equality used by the underlying map
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>,
+              typename KeyEqual = std::equal_to<Key>>
+    class fused_lru_cache
+    {
+        struct lru_links
+        {
+            lru_links* prev = this;
+            lru_links* next = this;
+        };
+
+        struct lru_entry : lru_links
+        {
+            explicit lru_entry(const Value& v) : value{v} {}
+
+            Value value;
+            const Key* key = nullptr; // points at the owning map node's key
+        };
+
+        using map_type = std::unordered_map<Key, lru_entry, Hash, KeyEqual>;
+
+    public:
+        using on_erase_cb = typename std::function<void(const Key&, const Value&)>;
+
+        /*
+         * Read-only iterator yielding (key, value) pairs, so call sites can use
+         * result.first->second exactly like with fixed_sized_cache.
+         */
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<const Key&, const Value&>;
+            using reference = value_type;
+            using difference_type = std::ptrdiff_t;
+
+            struct pointer
+            {
+                value_type pair;
+                const value_type* operator->() const noexcept { return &pair; }
+            };
+
+            const_iterator() = default;
+            explicit const_iterator(typename map_type::const_iterator it) : it{it} {}
+
+            reference operator*() const { return {it->first, it->second.value}; }
+            pointer operator->() const { return pointer{**this}; }
+
+            const_iterator& operator++()
+            {
+                ++it;
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                auto copy = *this;
+                ++it;
+                return copy;
+            }
+
+            bool operator==(const const_iterator& other) const { return it == other.it; }
+            bool operator!=(const const_iterator& other) const { return it != other.it; }
+
+        private:
+            typename map_type::const_iterator it;
+        };
+
+        /*
+         * Constructor
+         * max_size - Maximum number of elements in the cache
+         * on_erase - Optional callback when an item is evicted
+         */
+        explicit fused_lru_cache(
+            size_t max_size,
+            on_erase_cb on_erase = [](const Key&, const Value&) {})
+            : max_cache_size{max_size},
+              on_erase_callback{on_erase}
+        {
+            if (max_cache_size == 0)
+            {
+                throw std::invalid_argument{"Cache size must be greater than zero."};
+            }
+            // Put inserts before evicting, so the map briefly holds one extra
+            // entry; reserving for it means the map never rehashes.
+            cache_items_map.reserve(max_cache_size + 1);
+        }
+
+        // Entries link to the sentinel stored inside this object
+        fused_lru_cache(const fused_lru_cache&) = delete;
+        fused_lru_cache& operator=(const fused_lru_cache&) = delete;
+
+        ~fused_lru_cache() noexcept { Clear(); }
+
+        // Adds or updates an entry; a single hash lookup in the common case
+        void Put(const Key& key, const Value& value)
+        {
+            auto [element, inserted] = cache_items_map.try_emplace(key, value);
+            lru_entry& entry = element->second;
+
+            if (!inserted)
+            {
+                entry.value = value;
+                MoveToFront(entry);
+                return;
+            }
+
+            entry.key = &element->first;
+            LinkFront(entry);
+
+            if (cache_items_map.size() > max_cache_size)
+            {
+                EvictLeastRecent();
+            }
+        }
+
+        // Try to get element by key; returns pair<iterator, found>
+        std::pair<const_iterator, bool> TryGet(const Key& key) noexcept
+        {
+            auto element = cache_items_map.find(key);
+
+            if (element != cache_items_map.end())
+            {
+                MoveToFront(element->second);
+                return {const_iterator{element}, true};
+            }
+
+            return {const_iterator{element}, false};
+        }
+
+        // Get value by key, throws if key not found
+        const Value& Get(const Key& key)
+        {
+            auto element = cache_items_map.find(key);
+            if (element == cache_items_map.end())
+            {
+                throw std::range_error("Key not found in cache.");
+            }
+            MoveToFront(element->second);
+            return element->second.value;
+        }
+
+        // Check if a key exists
+        bool Cached(const Key& key) const noexcept
+        {
+            return cache_items_map.find(key) != cache_items_map.end();
+        }
+
+        // Return number of entries
+        std::size_t Size() const noexcept { return cache_items_map.size(); }
+
+        // Remove a key, return true if it existed
+        bool Remove(const Key& key)
+        {
+            auto it = cache_items_map.find(key);
+            if (it == cache_items_map.end()) return false;
+
+            Erase(it);
+            return true;
+        }
+
+        // Remove everything
+        void Clear()
+        {
+            cache_items_map.clear();
+            recency_list.prev = recency_list.next = &recency_list;
+        }
+
+        const_iterator begin() const noexcept { return const_iterator{cache_items_map.cbegin()}; }
+        const_iterator end() const noexcept { return const_iterator{cache_items_map.cend()}; }
+
+    private:
+        static void Unlink(lru_links& node) noexcept
+        {
+            node.prev->next = node.next;
+            node.next->prev = node.prev;
+        }
+
+        void LinkFront(lru_links& node) noexcept
+        {
+            node.prev = &recency_list;
+            node.next = recency_list.next;
+            recency_list.next->prev = &node;
+            recency_list.next = &node;
+        }
+
+        void MoveToFront(lru_links& node) noexcept
+        {
+            if (recency_list.next == &node) return;
+
+            Unlink(node);
+            LinkFront(node);
+        }
+
+        void EvictLeastRecent()
+        {
+            auto& victim = static_cast<lru_entry&>(*recency_list.prev);
+            Erase(cache_items_map.find(*victim.key));
+        }
+
+        void Erase(typename map_type::iterator it)
+        {
+            Unlink(it->second);
+            on_erase_callback(it->first, it->second.value);
+            cache_items_map.erase(it);
+        }
+
+        map_type cache_items_map;
+        lru_links recency_list; // sentinel: next is most recent, prev is least recent
+        std::size_t max_cache_size;
+        on_erase_cb on_erase_callback;
+    };
+} // namespace caches
+
+#endif
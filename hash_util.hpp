@@ -0,0 +1,53 @@
+#ifndef HASH_UTIL_HPP
+#define HASH_UTIL_HPP
+
+#include <cstdint>
+#include <functional>
+
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace caches
+{
+    /*
+     * Finalizer from MurmurHash3. std::hash is the identity for integers on
+     * the common standard libraries, so anything that uses only some of the
+     * hash bits (shard selection, power-of-two tables) mixes it first.
+     */
+    inline std::uint64_t mix_hash(std::uint64_t h) noexcept
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /*
+     * The hash of key that the library's tables share: std::hash remixed.
+     * fixed_sized_cache (with flat_hash_map), the key_pool policies and
+     * sharded_cache's shard routing all use it, so one computation can
+     * serve all of them (see fixed_sized_cache::KeyHash).
+     */
+    template <typename Key>
+    std::uint64_t key_hash(const Key& key) noexcept(noexcept(std::hash<Key>{}(key)))
+    {
+        return mix_hash(static_cast<std::uint64_t>(std::hash<Key>{}(key)));
+    }
+
+    // Hint that `address` will be read soon; a no-op where unsupported
+    inline void prefetch_read(const void* address) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+        (void)address;
+#endif
+    }
+} // namespace caches
+
+#endif
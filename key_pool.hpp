@@ -0,0 +1,262 @@
+#ifndef KEY_POOL_HPP
+#define KEY_POOL_HPP
+
+#include "hash_util.hpp"
+#include "weigher.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+    /*
+     * Pooled bookkeeping storage for cache policies.
+     * Keys live in nodes inside one contiguous vector and are linked into any
+     * number of doubly linked lists by 32-bit indices. Released nodes go to a
+     * free list and a small open-addressing index maps keys to nodes, so once
+     * reserve() has sized the pool for the cache capacity no operation
+     * allocates. Allocator (rebound) allocates the nodes and the index.
+     */
+    template <typename Key, typename Allocator = std::allocator<Key>>
+    class key_pool
+    {
+    public:
+        using index_type = std::uint32_t;
+        static constexpr index_type npos = ~index_type{0};
+
+        // Head/tail of one list of nodes; a pool can host several of them
+        struct list
+        {
+            index_type head = npos;
+            index_type tail = npos;
+            std::size_t size = 0;
+        };
+
+        key_pool() = default;
+        explicit key_pool(const Allocator& alloc) : nodes(rebind<node>{alloc}), index_slots(rebind<index_type>{alloc}) {}
+
+        // Size the node storage and the index for `capacity` keys
+        void reserve(std::size_t capacity)
+        {
+            nodes.reserve(capacity);
+            if (capacity * 2 > index_slots.size())
+            {
+                Rehash(capacity * 2);
+            }
+        }
+
+        // Node holding key, or npos
+        index_type find(const Key& key) const noexcept { return find(key, HashOf(key)); }
+
+        // find with hash == key_hash(key) already computed
+        index_type find(const Key& key, std::uint64_t hash) const noexcept
+        {
+            if (index_slots.empty()) return npos;
+
+            for (std::size_t pos = hash & index_mask;; pos = (pos + 1) & index_mask)
+            {
+                const index_type id = index_slots[pos];
+                if (id == npos) return npos;
+                if (nodes[id].hash == hash && nodes[id].key == key) return id;
+            }
+        }
+
+        // Starts loading the index slot find(key) will probe first
+        void prefetch(const Key& key) const noexcept
+        {
+            if (!index_slots.empty()) prefetch_read(&index_slots[HashOf(key) & index_mask]);
+        }
+
+        // Store key in a fresh node (not linked into any list) and index it
+        index_type insert(const Key& key) { return insert(key, HashOf(key)); }
+
+        // insert with hash == key_hash(key) already computed
+        index_type insert(const Key& key, std::uint64_t hash)
+        {
+            if ((live_nodes + 1) * 2 > index_slots.size())
+            {
+                Rehash(index_slots.empty() ? 16 : index_slots.size() * 2);
+            }
+
+            index_type id;
+            if (free_head != npos)
+            {
+                id = free_head;
+                free_head = nodes[id].next;
+                nodes[id].key = key;
+                nodes[id].free = false;
+            }
+            else
+            {
+                if (nodes.size() >= npos)
+                {
+                    throw std::length_error("key_pool is limited to 2^32 - 1 keys.");
+                }
+                id = static_cast<index_type>(nodes.size());
+                nodes.push_back(node{key});
+            }
+
+            node& n = nodes[id];
+            n.hash = hash;
+            n.prev = n.next = npos;
+            n.tag = 0;
+            IndexInsert(id);
+            ++live_nodes;
+            return id;
+        }
+
+        // Drop a node (already unlinked from its list) and recycle it
+        void erase(index_type id) noexcept
+        {
+            IndexErase(id);
+            node& n = nodes[id];
+            // Release the key's own storage now rather than on reuse. Moving
+            // it out first: assigning an empty string keeps the old buffer.
+            if constexpr (std::is_nothrow_move_constructible_v<Key> && std::is_nothrow_default_constructible_v<Key> &&
+                          std::is_nothrow_move_assignable_v<Key>)
+            {
+                [[maybe_unused]] const Key released{std::move(n.key)};
+                n.key = Key{};
+            }
+            n.free = true;
+            n.next = free_head;
+            free_head = id;
+            --live_nodes;
+        }
+
+        const Key& key(index_type id) const noexcept { return nodes[id].key; }
+
+        // Bytes held: node and index storage plus the keys' own heap storage
+        std::size_t memory_usage() const noexcept
+        {
+            std::size_t total = nodes.capacity() * sizeof(node) + index_slots.capacity() * sizeof(index_type);
+            for (const node& n : nodes) total += estimated_size(n.key) - sizeof(Key);
+            return total;
+        }
+
+        // Small per-node marker, e.g. which list or segment the node is in
+        std::uint8_t tag(index_type id) const noexcept { return nodes[id].tag; }
+        void set_tag(index_type id, std::uint8_t value) noexcept { nodes[id].tag = value; }
+
+        index_type next(index_type id) const noexcept { return nodes[id].next; }
+        index_type prev(index_type id) const noexcept { return nodes[id].prev; }
+
+        std::size_t size() const noexcept { return live_nodes; }
+        bool empty() const noexcept { return live_nodes == 0; }
+
+        void push_front(list& l, index_type id) noexcept
+        {
+            node& n = nodes[id];
+            n.prev = npos;
+            n.next = l.head;
+            if (l.head != npos) nodes[l.head].prev = id;
+            else l.tail = id;
+            l.head = id;
+            ++l.size;
+        }
+
+        void push_back(list& l, index_type id) noexcept
+        {
+            node& n = nodes[id];
+            n.next = npos;
+            n.prev = l.tail;
+            if (l.tail != npos) nodes[l.tail].next = id;
+            else l.head = id;
+            l.tail = id;
+            ++l.size;
+        }
+
+        void unlink(list& l, index_type id) noexcept
+        {
+            node& n = nodes[id];
+            if (n.prev != npos) nodes[n.prev].next = n.next;
+            else l.head = n.next;
+            if (n.next != npos) nodes[n.next].prev = n.prev;
+            else l.tail = n.prev;
+            n.prev = n.next = npos;
+            --l.size;
+        }
+
+        void move_to_front(list& l, index_type id) noexcept
+        {
+            if (l.head == id) return;
+            unlink(l, id);
+            push_front(l, id);
+        }
+
+    private:
+        struct node
+        {
+            Key key;
+            std::uint64_t hash = 0;
+            index_type prev = npos;
+            index_type next = npos; // doubles as the free-list link
+            std::uint8_t tag = 0;
+            bool free = false; // on the free list
+        };
+
+        static std::uint64_t HashOf(const Key& key) noexcept { return key_hash(key); }
+
+        void IndexInsert(index_type id) noexcept
+        {
+            std::size_t pos = nodes[id].hash & index_mask;
+            while (index_slots[pos] != npos)
+            {
+                pos = (pos + 1) & index_mask;
+            }
+            index_slots[pos] = id;
+        }
+
+        // Backward-shift deletion keeps probe chains intact without tombstones
+        void IndexErase(index_type id) noexcept
+        {
+            std::size_t hole = nodes[id].hash & index_mask;
+            while (index_slots[hole] != id)
+            {
+                hole = (hole + 1) & index_mask;
+            }
+
+            for (std::size_t pos = (hole + 1) & index_mask; index_slots[pos] != npos;
+                 pos = (pos + 1) & index_mask)
+            {
+                const std::size_t home = nodes[index_slots[pos]].hash & index_mask;
+                if (((pos - home) & index_mask) >= ((pos - hole) & index_mask))
+                {
+                    index_slots[hole] = index_slots[pos];
+                    hole = pos;
+                }
+            }
+            index_slots[hole] = npos;
+        }
+
+        void Rehash(std::size_t min_slots)
+        {
+            std::size_t slot_count = 16;
+            while (slot_count < min_slots) slot_count *= 2;
+
+            index_slots.assign(slot_count, npos);
+            index_mask = slot_count - 1;
+
+            for (std::size_t id = 0; id < nodes.size(); ++id)
+            {
+                if (!nodes[id].free) IndexInsert(static_cast<index_type>(id));
+            }
+        }
+
+        template <typename T>
+        using rebind = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+        std::vector<node, rebind<node>> nodes;
+        std::vector<index_type, rebind<index_type>> index_slots;
+        std::size_t index_mask = 0;
+        std::size_t live_nodes = 0;
+        index_type free_head = npos;
+    };
+} // namespace caches
+
+#endif
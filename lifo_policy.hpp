@@ -2,8 +2,8 @@
 #define LIFO_CACHE_POLICY_HPP
 
 #include "cache_policy.hpp"
-#include <list>
-#include <unordered_map>
+#include "key_pool.hpp"
+#include <memory>
 #include <stdexcept>
 
 namespace caches
@@ -11,47 +11,79 @@ namespace caches
     /*
      * LIFO (Last-In, First-Out) Cache Policy
      * Evicts the most recently inserted key when full.
+     * Allocator allocates the key nodes and their index (see key_pool).
      */
-    template <typename Key>
-    class LIFOCachePolicy : public ICachePolicy<Key>
+    template <typename Key, typename Allocator = std::allocator<Key>>
+    class BasicLIFOCachePolicy
     {
+        using pool = key_pool<Key, Allocator>;
+
     public:
-        using lifo_iterator = typename std::list<Key>::const_iterator;
+        using node_id = typename pool::index_type;
+
+        BasicLIFOCachePolicy() = default;
+        explicit BasicLIFOCachePolicy(const Allocator& alloc) : key_nodes{alloc} {}
+        ~BasicLIFOCachePolicy() noexcept = default;
+
+        void Reserve(std::size_t capacity) {
+            key_nodes.reserve(capacity);
+        }
 
-        LIFOCachePolicy() = default;
-        ~LIFOCachePolicy() noexcept override = default;
+        void Insert(const Key& key) { Insert(key, key_hash(key)); }
+        void Erase(const Key& key) noexcept { Erase(key, key_hash(key)); }
 
-        void Insert(const Key& key) override {
-            if (key_lookup.find(key) != key_lookup.end()) return; // Avoid duplicates
+        // Same, with hash == key_hash(key) supplied by the cache
+        void Insert(const Key& key, std::uint64_t hash) {
+            if (key_nodes.find(key, hash) != pool::npos) return; // Avoid duplicates
 
-            lifo_stack.emplace_front(key);
-            key_lookup[key] = lifo_stack.begin();
+            key_nodes.push_front(lifo_stack, key_nodes.insert(key, hash));
         }
 
-        void Touch(const Key& key) noexcept override {
+        void Touch(const Key& key) noexcept {
             // LIFO does not care about accesses
             (void)key;
         }
 
-        void Erase(const Key& key) noexcept override {
-            auto it = key_lookup.find(key);
-            if (it == key_lookup.end()) return;
+        void Touch(const Key& key, std::uint64_t hash) noexcept {
+            (void)key;
+            (void)hash;
+        }
+
+        void Erase(const Key& key, std::uint64_t hash) noexcept {
+            const node_id id = key_nodes.find(key, hash);
+            if (id == pool::npos) return;
 
-            lifo_stack.erase(it->second);
-            key_lookup.erase(it);
+            key_nodes.unlink(lifo_stack, id);
+            key_nodes.erase(id);
         }
 
-        const Key& ReplacementCandidate() const override {
-            if (lifo_stack.empty()) {
+        const Key& ReplacementCandidate() const {
+            if (lifo_stack.size == 0) {
                 throw std::runtime_error("No keys available for eviction (LIFO).");
             }
-            return lifo_stack.front(); // most recently inserted
+            return key_nodes.key(lifo_stack.head); // most recently inserted
+        }
+
+        // Keys oldest first: inserting them in this order rebuilds the stack
+        template <typename Visit>
+        void ForEach(Visit&& visit) const {
+            for (node_id id = lifo_stack.tail; id != pool::npos; id = key_nodes.prev(id)) {
+                visit(key_nodes.key(id));
+            }
+        }
+
+        // Heap bytes of the policy: key nodes, their copies of the keys and the index
+        std::size_t MemoryUsage() const noexcept {
+            return key_nodes.memory_usage();
         }
 
     private:
-        std::list<Key> lifo_stack;
-        std::unordered_map<Key, lifo_iterator> key_lookup;
+        pool key_nodes;
+        typename pool::list lifo_stack; // head is the newest key
     };
+
+    template <typename Key>
+    using LIFOCachePolicy = BasicLIFOCachePolicy<Key>;
 }
 
-#endif 
\ No newline at end of file
+#endif
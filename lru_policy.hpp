@@ -2,8 +2,8 @@
 #define LRU_CACHE_POLICY_HPP
 
 #include "cache_policy.hpp"
-#include <list>
-#include <unordered_map>
+#include "key_pool.hpp"
+#include <memory>
 #include <stdexcept>
 
 namespace caches
@@ -11,49 +11,81 @@ namespace caches
     /*
      * LRU (Least Recently Used) Cache Policy
      * Evicts the least recently accessed key.
+     * Allocator allocates the key nodes and their index (see key_pool).
      */
-    template <typename Key>
-    class LRUCachePolicy : public ICachePolicy<Key>
+    template <typename Key, typename Allocator = std::allocator<Key>>
+    class BasicLRUCachePolicy
     {
+        using pool = key_pool<Key, Allocator>;
+
     public:
-        using lru_iterator = typename std::list<Key>::iterator;
+        using node_id = typename pool::index_type;
 
-        LRUCachePolicy() = default;
-        ~LRUCachePolicy() noexcept override = default;
+        BasicLRUCachePolicy() = default;
+        explicit BasicLRUCachePolicy(const Allocator& alloc) : key_nodes{alloc} {}
+        ~BasicLRUCachePolicy() noexcept = default;
+
+        void Reserve(std::size_t capacity) {
+            key_nodes.reserve(capacity);
+        }
 
-        void Insert(const Key& key) override {
-            if (key_finder.find(key) != key_finder.end()) return; // prevent duplicate
+        void Insert(const Key& key) { Insert(key, key_hash(key)); }
+        void Touch(const Key& key) { Touch(key, key_hash(key)); }
+        void Erase(const Key& key) noexcept { Erase(key, key_hash(key)); }
 
-            lru_queue.emplace_front(key);
-            key_finder[key] = lru_queue.begin();
+        // Same, with hash == key_hash(key) supplied by the cache
+        void Insert(const Key& key, std::uint64_t hash) {
+            if (key_nodes.find(key, hash) != pool::npos) return; // prevent duplicate
+
+            key_nodes.push_front(lru_queue, key_nodes.insert(key, hash));
         }
 
-        void Touch(const Key& key) override {
-            auto it = key_finder.find(key);
-            if (it == key_finder.end()) return;
+        void Touch(const Key& key, std::uint64_t hash) {
+            const node_id id = key_nodes.find(key, hash);
+            if (id == pool::npos) return;
+
+            key_nodes.move_to_front(lru_queue, id);
+        }
 
-            lru_queue.splice(lru_queue.begin(), lru_queue, it->second); // move to front
+        void Prefetch(const Key& key) const noexcept {
+            key_nodes.prefetch(key);
         }
 
-        void Erase(const Key& key) noexcept override {
-            auto it = key_finder.find(key);
-            if (it == key_finder.end()) return;
+        void Erase(const Key& key, std::uint64_t hash) noexcept {
+            const node_id id = key_nodes.find(key, hash);
+            if (id == pool::npos) return;
 
-            lru_queue.erase(it->second);
-            key_finder.erase(it);
+            key_nodes.unlink(lru_queue, id);
+            key_nodes.erase(id);
         }
 
-        const Key& ReplacementCandidate() const override {
-            if (lru_queue.empty()) {
+        const Key& ReplacementCandidate() const {
+            if (lru_queue.size == 0) {
                 throw std::runtime_error("No keys available for eviction (LRU).");
             }
-            return lru_queue.back(); // least recently used
+            return key_nodes.key(lru_queue.tail); // least recently used
+        }
+
+        // Keys oldest first: inserting them in this order rebuilds the recency order
+        template <typename Visit>
+        void ForEach(Visit&& visit) const {
+            for (node_id id = lru_queue.tail; id != pool::npos; id = key_nodes.prev(id)) {
+                visit(key_nodes.key(id));
+            }
+        }
+
+        // Heap bytes of the policy: key nodes, their copies of the keys and the index
+        std::size_t MemoryUsage() const noexcept {
+            return key_nodes.memory_usage();
         }
 
     private:
-        std::list<Key> lru_queue;
-        std::unordered_map<Key, lru_iterator> key_finder;
+        pool key_nodes;
+        typename pool::list lru_queue; // head is the most recently used
     };
+
+    template <typename Key>
+    using LRUCachePolicy = BasicLRUCachePolicy<Key>;
 }
 
-#endif 
+#endif
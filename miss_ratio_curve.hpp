@@ -0,0 +1,423 @@
+#ifndef MISS_RATIO_CURVE_HPP
+#define MISS_RATIO_CURVE_HPP
+
+#include "cache.hpp"
+#include "flat_hash_map.hpp"
+#include "hash_util.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace caches
+{
+    // Estimated hit ratio of a cache holding `size` entries
+    struct mrc_point
+    {
+        std::size_t size;
+        double hit_ratio;
+    };
+
+    namespace detail
+    {
+        /*
+         * Spatial sampling as in SHARDS: a key is sampled when the top 24
+         * bits of its key_hash fall below a threshold, so every access of a
+         * sampled key is seen and the sample is a rate-R subset of the keys,
+         * not of the accesses. The hash is remixed with an offset first:
+         * mix_hash maps 0 to 0, which would always sample the key 0.
+         */
+        constexpr unsigned sample_bits = 24;
+        constexpr std::uint32_t sample_modulus = std::uint32_t{1} << sample_bits;
+
+        inline std::uint32_t sample_spot(std::uint64_t hash) noexcept
+        {
+            return static_cast<std::uint32_t>(mix_hash(hash + 0x9E3779B97F4A7C15ULL) >> (64 - sample_bits));
+        }
+
+        inline std::uint32_t sample_threshold(double rate)
+        {
+            if (!(rate > 0.0 && rate <= 1.0))
+            {
+                throw std::invalid_argument{"Sampling rate must be in (0, 1]."};
+            }
+            return std::max<std::uint32_t>(1, static_cast<std::uint32_t>(std::lround(rate * sample_modulus)));
+        }
+
+        /*
+         * Hit ratio from sampled counts, corrected as in SHARDS-adj: whether
+         * a few very hot keys happen to be sampled swings the sampled
+         * reference count away from the expected R * accesses. Those are
+         * references to keys that hit at any size, so the difference goes to
+         * (or comes off) the hits.
+         */
+        inline double adjusted_hit_ratio(double hits, double sampled, double expected) noexcept
+        {
+            if (expected < 1.0) return hits / sampled;
+            return std::clamp((hits + expected - sampled) / expected, 0.0, 1.0);
+        }
+
+        // Counts per position with prefix sums in O(log n)
+        class fenwick_tree
+        {
+        public:
+            explicit fenwick_tree(std::size_t size = 0) : counts(size + 1, 0) {}
+
+            std::size_t size() const noexcept { return counts.size() - 1; }
+
+            void add(std::size_t pos, std::int32_t delta) noexcept
+            {
+                for (std::size_t i = pos + 1; i < counts.size(); i += i & (~i + 1)) counts[i] += delta;
+            }
+
+            // Sum of positions [0, pos]
+            std::int64_t prefix(std::size_t pos) const noexcept
+            {
+                std::int64_t sum = 0;
+                for (std::size_t i = pos + 1; i > 0; i -= i & (~i + 1)) sum += counts[i];
+                return sum;
+            }
+
+            // Resets to size positions whose first `ones` hold 1
+            void assign_ones(std::size_t size, std::size_t ones)
+            {
+                counts.assign(size + 1, 0);
+                for (std::size_t i = 1; i <= size; ++i)
+                {
+                    if (i <= ones) counts[i] += 1;
+                    const std::size_t parent = i + (i & (~i + 1));
+                    if (parent <= size) counts[parent] += counts[i];
+                }
+            }
+
+        private:
+            std::vector<std::int32_t> counts;
+        };
+    } // namespace detail
+
+    /*
+     * Online LRU miss-ratio curve, estimated with SHARDS: the reuse (stack)
+     * distance of every sampled access is measured among the sampled keys
+     * with a Fenwick tree over access times, scaled by 1/R and added to a
+     * histogram. A remix and one compare decide that an access isn't
+     * sampled, so feeding every lookup to Record is cheap.
+     * At most max_samples keys are tracked: when there are more, the keys
+     * with the highest hash spots are dropped and the rate is lowered to
+     * match (SHARDS fixed-size), so memory stays bounded and a few thousand
+     * keys are sampled whatever the key space. With max_samples == 0 the
+     * rate is fixed and memory grows with R times the number of keys.
+     * Key - Type of the key (hashable with key_hash, copyable)
+     */
+    template <typename Key>
+    class shards_mrc
+    {
+    public:
+        /*
+         * Constructor
+         * sampling_rate - Fraction R of the keys to track, at first
+         * max_samples - Bound on tracked keys, 0 for a fixed rate
+         */
+        explicit shards_mrc(double sampling_rate = 0.01, std::size_t max_samples = 8192)
+            : threshold{detail::sample_threshold(sampling_rate)},
+              max_keys{max_samples},
+              bin_width{std::max(1.0, std::floor(1.0 / SamplingRate()))},
+              times(1024)
+        {
+        }
+
+        void Record(const Key& key) { Record(key, key_hash(key)); }
+
+        // Record with hash == key_hash(key) already computed
+        void Record(const Key& key, std::uint64_t hash)
+        {
+            ++accesses;
+            const std::uint32_t spot = detail::sample_spot(hash);
+            if (spot >= threshold) return;
+            Sample(key, hash, spot);
+        }
+
+        // Estimated LRU hit ratio with room for cache_size entries
+        double HitRatio(std::size_t cache_size) const noexcept
+        {
+            if (sampled <= 0.0) return 0.0;
+
+            const double limit = static_cast<double>(cache_size) / bin_width;
+            const std::size_t whole = std::min(histogram.size(), static_cast<std::size_t>(limit));
+            double hits = 0.0;
+            for (std::size_t bin = 0; bin < whole; ++bin) hits += histogram[bin];
+            if (whole < histogram.size()) hits += histogram[whole] * (limit - static_cast<double>(whole));
+            return detail::adjusted_hit_ratio(hits / unit, sampled / unit, static_cast<double>(accesses) * SamplingRate());
+        }
+
+        std::vector<mrc_point> Curve(const std::vector<std::size_t>& sizes) const
+        {
+            std::vector<mrc_point> curve;
+            curve.reserve(sizes.size());
+            for (const std::size_t size : sizes) curve.push_back({size, HitRatio(size)});
+            return curve;
+        }
+
+        // Current rate; below the initial one once max_samples was reached
+        double SamplingRate() const noexcept
+        {
+            return static_cast<double>(threshold) / detail::sample_modulus;
+        }
+
+        std::uint64_t Accesses() const noexcept { return accesses; }
+        std::size_t TrackedKeys() const noexcept { return last_access.size(); }
+
+    private:
+        struct tracked
+        {
+            std::size_t time; // latest access
+        };
+
+        // Orders the eviction heap by spot only; Key needn't be comparable
+        struct spot_less
+        {
+            bool operator()(const std::pair<std::uint32_t, Key>& a,
+                            const std::pair<std::uint32_t, Key>& b) const noexcept
+            {
+                return a.first < b.first;
+            }
+        };
+
+        // Everything that allocates comes before the state changes, so a
+        // bad_alloc drops this one sample and leaves the estimate consistent
+        void Sample(const Key& key, std::uint64_t hash, std::uint32_t spot)
+        {
+            if (now == times.size()) Compact();
+
+            auto [entry, inserted] = last_access.try_emplace_hashed(hash, key, tracked{now});
+            if (inserted)
+            {
+                if (max_keys != 0)
+                {
+                    try
+                    {
+                        by_spot.emplace(spot, key);
+                    }
+                    catch (...)
+                    {
+                        last_access.erase(entry);
+                        throw;
+                    }
+                }
+            }
+            else
+            {
+                // Distinct sampled keys used since the previous access
+                const std::size_t last = entry->second.time;
+                const std::int64_t distance = times.prefix(now - 1) - times.prefix(last);
+                AddDistance(static_cast<double>(distance) / SamplingRate());
+                times.add(last, -1);
+                entry->second.time = now;
+            }
+            sampled += unit;
+            times.add(now, 1);
+            ++now;
+
+            if (max_keys != 0 && last_access.size() > max_keys) LowerRate();
+        }
+
+        void AddDistance(double distance)
+        {
+            const std::size_t bin = static_cast<std::size_t>(distance / bin_width);
+            if (bin >= histogram.size()) histogram.resize(std::max(bin + 1, histogram.size() * 2), 0.0);
+            histogram[bin] += unit;
+        }
+
+        // Drops the keys with the highest spot and lowers the threshold to it
+        void LowerRate()
+        {
+            const double old_rate = SamplingRate();
+            const std::uint32_t highest = by_spot.top().first;
+            if (highest == 0) return; // can't go lower
+            while (!by_spot.empty() && by_spot.top().first == highest)
+            {
+                const auto found = last_access.find(by_spot.top().second);
+                times.add(found->second.time, -1);
+                last_access.erase(found);
+                by_spot.pop();
+            }
+            threshold = highest;
+
+            // Past accesses were counted at the old rate: rather than scaling
+            // them down, later ones count more
+            unit *= old_rate / SamplingRate();
+        }
+
+        // Renumbers the access times of the tracked keys 0..n-1, in order
+        void Compact()
+        {
+            std::vector<tracked*> live;
+            live.reserve(last_access.size());
+            for (auto& entry : last_access) live.push_back(&entry.second);
+            std::sort(live.begin(), live.end(), [](const tracked* a, const tracked* b) { return a->time < b->time; });
+
+            times.assign_ones(std::max<std::size_t>(1024, 2 * live.size()), live.size());
+            for (std::size_t i = 0; i < live.size(); ++i) live[i]->time = i;
+            now = live.size();
+        }
+
+        std::uint32_t threshold;
+        std::size_t max_keys;
+        double bin_width; // scaled distance per histogram bin
+        flat_hash_map<Key, tracked> last_access;
+        std::priority_queue<std::pair<std::uint32_t, Key>, std::vector<std::pair<std::uint32_t, Key>>, spot_less>
+            by_spot; // tracked keys, highest spot on top (bounded mode only)
+        detail::fenwick_tree times; // 1 at the latest access time of each tracked key
+        std::size_t now = 0;
+        std::vector<double> histogram; // sampled accesses per scaled reuse distance bin, in units
+        double sampled = 0.0;          // sampled accesses, in units
+        double unit = 1.0;             // weight of one access sampled at the current rate
+        std::uint64_t accesses = 0;
+    };
+
+    /*
+     * Hit ratios of any policy at a few candidate sizes, by miniature
+     * simulation: the sampled keys (chosen like shards_mrc) run through a
+     * fixed_sized_cache<Key, bool, Policy> of R * size entries per candidate.
+     * Works for every policy, including the ones that aren't stack
+     * algorithms (FIFO, CLOCK, TinyLFU, ARC, ...). The rate is fixed: pick
+     * one that samples a few thousand keys and scales every candidate to at
+     * least ~100 entries, or the estimates get noisy.
+     * Key - Type of the key
+     * Policy - Eviction policy to simulate
+     */
+    template <typename Key, template <typename> class Policy>
+    class policy_mrc
+    {
+        struct no_erase
+        {
+            void operator()(const Key&, const bool&) const noexcept {}
+        };
+
+        using simulated_cache = fixed_sized_cache<Key, bool, Policy, flat_hash_map<Key, bool>, unit_weigher,
+                                                  no_stats, no_erase>;
+
+    public:
+        /*
+         * Constructor
+         * sizes - Candidate cache sizes (full scale)
+         * sampling_rate - Fraction R of the keys to simulate
+         */
+        explicit policy_mrc(std::vector<std::size_t> sizes = {}, double sampling_rate = 0.01)
+            : threshold{detail::sample_threshold(sampling_rate)}
+        {
+            for (const std::size_t size : sizes)
+            {
+                const auto scaled = static_cast<std::size_t>(std::lround(static_cast<double>(size) * SamplingRate()));
+                sims.push_back({size, std::make_unique<simulated_cache>(std::max<std::size_t>(1, scaled)), 0});
+            }
+        }
+
+        void Record(const Key& key) { Record(key, key_hash(key)); }
+
+        // Record with hash == key_hash(key) already computed
+        void Record(const Key& key, std::uint64_t hash)
+        {
+            ++accesses;
+            if (detail::sample_spot(hash) >= threshold) return;
+
+            ++sampled;
+            for (auto& sim : sims)
+            {
+                // Emplace rather than the noexcept Put: copying the key may throw
+                if (sim.cache->TryGet(key, hash).second) ++sim.hits;
+                else sim.cache->Emplace(key, true);
+            }
+        }
+
+        // Estimated hit ratio at one of the candidate sizes
+        double HitRatio(std::size_t cache_size) const
+        {
+            for (const auto& sim : sims)
+            {
+                if (sim.size != cache_size) continue;
+                if (sampled == 0) return 0.0;
+                return detail::adjusted_hit_ratio(static_cast<double>(sim.hits), static_cast<double>(sampled),
+                                                  static_cast<double>(accesses) * SamplingRate());
+            }
+            throw std::invalid_argument{"Size is not one of the simulated candidates."};
+        }
+
+        std::vector<mrc_point> Curve() const
+        {
+            std::vector<mrc_point> curve;
+            curve.reserve(sims.size());
+            for (const auto& sim : sims) curve.push_back({sim.size, HitRatio(sim.size)});
+            return curve;
+        }
+
+        double SamplingRate() const noexcept
+        {
+            return static_cast<double>(threshold) / detail::sample_modulus;
+        }
+
+        std::uint64_t Accesses() const noexcept { return accesses; }
+
+    private:
+        struct simulation
+        {
+            std::size_t size;
+            std::unique_ptr<simulated_cache> cache;
+            std::uint64_t hits;
+        };
+
+        std::uint32_t threshold;
+        std::vector<simulation> sims;
+        std::uint64_t sampled = 0;
+        std::uint64_t accesses = 0;
+    };
+
+    /*
+     * Stats for fixed_sized_cache that feed every lookup (TryGet, Get,
+     * MultiGet by Key) to one or more estimators, next to the hooks of the
+     * wrapped Stats. A Put after a miss is the same reference and is not
+     * recorded again. Estimators are reached with Statistics().Estimator<I>();
+     * assign them before the cache sees traffic to pick a rate or sizes:
+     *
+     *   using S = mrc_stats<no_stats, shards_mrc<int>, policy_mrc<int, FIFOCachePolicy>>;
+     *   fixed_sized_cache<int, V, LRUCachePolicy, std::unordered_map<int, V>, unit_weigher, S> cache{n};
+     *   cache.Statistics().Estimator<1>() = policy_mrc<int, FIFOCachePolicy>{{n / 2, n, 2 * n}};
+     *
+     * Like the cache, the estimators are not thread-safe: a sharded_cache
+     * with mrc_stats takes the exclusive shard lock for lookups. Recording a
+     * sampled key may allocate, so lookups through mrc_stats aren't noexcept;
+     * a bad_alloc drops that sample and leaves cache and estimators intact.
+     */
+    template <typename Stats, typename... Estimators>
+    class mrc_stats : public Stats
+    {
+    public:
+        template <typename Key>
+        void OnAccess(const Key& key, std::uint64_t hash)
+        {
+            std::apply([&](auto&... estimator) { (estimator.Record(key, hash), ...); }, estimators);
+        }
+
+        template <std::size_t I>
+        auto& Estimator() noexcept
+        {
+            return std::get<I>(estimators);
+        }
+
+        template <std::size_t I>
+        const auto& Estimator() const noexcept
+        {
+            return std::get<I>(estimators);
+        }
+
+    private:
+        std::tuple<Estimators...> estimators;
+    };
+} // namespace caches
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace caches
+{
+    /*
+     * NUMA nodes and their CPUs, read once from /sys on Linux. Elsewhere, or
+     * when /sys is unavailable, the machine is reported as a single node.
+     */
+    class numa_topology
+    {
+    public:
+        static const numa_topology& Get()
+        {
+            static const numa_topology topology;
+            return topology;
+        }
+
+        std::size_t Nodes() const noexcept { return node_cpus.size(); }
+
+        // CPUs of `node`, in increasing order
+        const std::vector<int>& Cpus(std::size_t node) const { return node_cpus.at(node); }
+
+        // Kernel id of `node`; ids can have gaps where a node has no CPUs
+        int Id(std::size_t node) const { return node_ids.at(node); }
+
+        // Node of the CPU the calling thread is running on
+        std::size_t CurrentNode() const noexcept
+        {
+#if defined(__linux__)
+            const int cpu = ::sched_getcpu();
+            if (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_node.size()) return cpu_node[cpu];
+#endif
+            return 0;
+        }
+
+    private:
+        numa_topology()
+        {
+#if defined(__linux__)
+            for (const int node : ReadList("/sys/devices/system/node/online"))
+            {
+                const auto cpus = ReadList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                if (cpus.empty()) continue; // memory-only node
+
+                for (const int cpu : cpus)
+                {
+                    if (static_cast<std::size_t>(cpu) >= cpu_node.size()) cpu_node.resize(cpu + 1, 0);
+                    cpu_node[cpu] = node_cpus.size();
+                }
+                node_cpus.push_back(cpus);
+                node_ids.push_back(node);
+            }
+#endif
+            if (node_cpus.empty())
+            {
+                node_cpus.emplace_back();
+                node_ids.push_back(0);
+                cpu_node.clear();
+            }
+        }
+
+        // Parses a kernel list such as "0-3,8-11"; empty if unreadable
+        static std::vector<int> ReadList(const std::string& path)
+        {
+            std::vector<int> items;
+            std::ifstream in{path};
+            std::string list;
+            if (!std::getline(in, list)) return items;
+
+            std::stringstream ranges{list};
+            for (std::string range; std::getline(ranges, range, ',');)
+            {
+                const auto dash = range.find('-');
+                try
+                {
+                    const int first = std::stoi(range.substr(0, dash));
+                    const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                    for (int i = first; i <= last; ++i) items.push_back(i);
+                }
+                catch (const std::exception&)
+                {
+                    return {};
+                }
+            }
+            return items;
+        }
+
+        std::vector<std::vector<int>> node_cpus;
+        std::vector<int> node_ids;
+        std::vector<std::size_t> cpu_node; // CPU -> index into node_cpus
+    };
+
+    /*
+     * Runs f() on a thread bound to the CPUs of `node` (an index below
+     * numa_topology::Nodes(), taken modulo it) whose allocations prefer
+     * `node`'s memory, and waits for it; f's exception is rethrown. Memory
+     * f allocates and touches therefore lands on that node (first touch).
+     * On a single-node machine f simply runs on the calling thread.
+     */
+    template <typename F>
+    void RunOnNode(std::size_t node, F&& f)
+    {
+        const numa_topology& topology = numa_topology::Get();
+        if (topology.Nodes() <= 1)
+        {
+            f();
+            return;
+        }
+
+        std::exception_ptr failure;
+        std::thread worker{[&] {
+#if defined(__linux__)
+            const std::size_t target = node % topology.Nodes();
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (const int cpu : topology.Cpus(target)) CPU_SET(cpu, &cpus);
+            ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+
+            // set_mempolicy(MPOL_PREFERRED, {node}); best effort, no libnuma needed
+            constexpr int mpol_preferred = 1;
+            const int id = topology.Id(target);
+            if (id >= 0 && static_cast<std::size_t>(id) < 8 * sizeof(unsigned long))
+            {
+                const unsigned long mask = 1UL << id;
+                ::syscall(SYS_set_mempolicy, mpol_preferred, &mask, 8 * sizeof(mask) + 1);
+            }
+#endif
+            try
+            {
+                f();
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+            }
+        }};
+        worker.join();
+        if (failure) std::rethrow_exception(failure);
+    }
+} // namespace caches
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef PINNED_CACHE_HPP
+#define PINNED_CACHE_HPP
+
+#include "sharded_cache.hpp"
+#include "weigher.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace caches
+{
+    /*
+     * Reference-counted, read-only view of a cached value. Holding one keeps
+     * the value alive after it is evicted, replaced or removed, until the
+     * last handle is released; an empty handle means a miss.
+     */
+    template <typename T>
+    using value_handle = std::shared_ptr<const T>;
+
+    /*
+     * Weighs a handle by the value it points to (plus the shared control
+     * block), using Inner for the key and the pointee.
+     */
+    template <typename Inner = memory_weigher>
+    struct pointee_weigher
+    {
+        Inner inner{};
+
+        template <typename Key, typename T>
+        std::size_t operator()(const Key& key, const value_handle<T>& value) const
+        {
+            constexpr std::size_t control_block = 2 * sizeof(long);
+            return inner(key, *value) + control_block;
+        }
+    };
+
+    /*
+     * Thread-safe cache whose lookups hand out value_handles instead of
+     * copies: a hit costs one reference-count increment under the shard
+     * lock, and the reader then uses the value in place, lock-free, for as
+     * long as it keeps the handle. Values are immutable once stored; Put
+     * replaces the handle, so readers of the old value are not disturbed.
+     * A pinned value that has been evicted no longer counts against the
+     * capacity, even though its memory stays in use.
+     * Key - Type of the key (must be hashable)
+     * T - Type of value
+     * Policy - Eviction policy of every shard
+     * Shards - Number of shards (see sharded_cache)
+     * Weigher - Entry cost function over (key, value); unit_weigher counts entries
+     * Stats - Statistics hooks kept per shard (see cache_stats.hpp)
+     */
+    template <typename Key, typename T, template <typename> class Policy = NoCachePolicy, std::size_t Shards = 16,
+              typename Weigher = unit_weigher, typename Stats = no_stats>
+    class pinned_cache
+    {
+    public:
+        using key_type = Key;
+        using handle = value_handle<T>;
+        using entry_weigher =
+            std::conditional_t<std::is_same_v<Weigher, unit_weigher>, unit_weigher, pointee_weigher<Weigher>>;
+        using cache_type = sharded_cache<Key, handle, Policy, Shards, std::unordered_map<Key, handle>,
+                                         entry_weigher, Stats>;
+        using on_erase_cb = typename cache_type::on_erase_cb;
+
+        /*
+         * Constructor
+         * max_size - Total number of elements, or total weight with a Weigher
+         * policy - Eviction policy, copied into every shard
+         * on_erase - Optional callback when a handle leaves the cache
+         */
+        explicit pinned_cache(std::size_t max_size, const Policy<Key>& policy = Policy<Key>{},
+                              on_erase_cb on_erase = {}, const Weigher& weigher = Weigher{})
+            : cache{max_size, policy, on_erase ? std::move(on_erase) : on_erase_cb{[](const Key&, const handle&) {}},
+                    MakeWeigher(weigher)}
+        {
+        }
+
+        // Stores value; returns the handle now cached for it
+        handle Put(const Key& key, T value)
+        {
+            handle stored = std::make_shared<const T>(std::move(value));
+            cache.Put(key, stored);
+            return stored;
+        }
+
+        // Caches an existing handle (e.g. one shared with another structure)
+        void Put(const Key& key, handle value)
+        {
+            if (!value) throw std::invalid_argument{"Cannot cache an empty value handle."};
+            cache.Put(key, value);
+        }
+
+        // Handle to the value, or an empty handle on a miss
+        handle TryGet(const Key& key)
+        {
+            auto found = cache.TryGet(key);
+            return found ? std::move(*found) : handle{};
+        }
+
+        /*
+         * Handle to the value, loading it once on a miss (single-flight, see
+         * sharded_cache::GetOrLoad). loader(key) returns a T or a handle.
+         */
+        template <typename Loader>
+        handle GetOrLoad(const Key& key, Loader&& loader)
+        {
+            return cache.GetOrLoad(key, [&loader](const Key& missing) -> handle {
+                if constexpr (std::is_convertible_v<std::invoke_result_t<Loader&, const Key&>, handle>)
+                {
+                    handle loaded = loader(missing);
+                    if (!loaded) throw std::invalid_argument{"Loader returned an empty value handle."};
+                    return loaded;
+                }
+                else
+                {
+                    return std::make_shared<const T>(loader(missing));
+                }
+            });
+        }
+
+        bool Cached(const Key& key) const { return cache.Cached(key); }
+        bool Remove(const Key& key) { return cache.Remove(key); }
+        void Clear() { cache.Clear(); }
+
+        std::size_t Size() const { return cache.Size(); }
+        std::size_t Weight() const { return cache.Weight(); }
+        std::size_t MaxSize() const noexcept { return cache.MaxSize(); }
+
+        template <typename S = Stats>
+        auto Statistics() const -> decltype(std::declval<const S&>().Snapshot())
+        {
+            return cache.Statistics();
+        }
+
+    private:
+        static entry_weigher MakeWeigher(const Weigher& weigher)
+        {
+            if constexpr (std::is_same_v<Weigher, unit_weigher>)
+            {
+                return weigher;
+            }
+            else
+            {
+                return entry_weigher{weigher};
+            }
+        }
+
+        cache_type cache;
+    };
+} // namespace caches
+
+#endif
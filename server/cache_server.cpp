@@ -0,0 +1,95 @@
+/*
+ * Standalone cache node: a byte-budgeted sharded LRU cache of byte strings
+ * behind cache_server. Stops on SIGINT / SIGTERM.
+ *
+ *   g++ -std=c++17 -O2 -DNDEBUG -I. server/cache_server.cpp -o cache_server -pthread
+ *   ./cache_server --port=11311 --memory=1024 --workers=8
+ *
+ * Options:
+ *   --address=IPV4   address to listen on (default 0.0.0.0)
+ *   --port=N         TCP port (default 11311)
+ *   --memory=MiB     byte budget for keys and values (default 256)
+ *   --workers=N      event-loop threads, one per core by default
+ */
+#include "cache_server.hpp"
+#include "flat_hash_map.hpp"
+#include "lru_policy.hpp"
+#include "sharded_cache.hpp"
+#include "weigher.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <signal.h>
+
+namespace
+{
+    using node_cache = caches::sharded_cache<std::string, std::string, caches::LRUCachePolicy, 64,
+                                             caches::flat_hash_map<std::string, std::string>, caches::memory_weigher>;
+
+    struct options
+    {
+        caches::cache_server<node_cache>::options server;
+        std::size_t memory_mib = 256;
+    };
+
+    options ParseOptions(int argc, char** argv)
+    {
+        options opts;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const auto value = [&](const char* flag) -> const char* {
+                const std::string prefix = std::string{flag} + "=";
+                return arg.compare(0, prefix.size(), prefix) == 0 ? argv[i] + prefix.size() : nullptr;
+            };
+
+            if (const char* v = value("--address")) opts.server.address = v;
+            else if (const char* v = value("--port")) opts.server.port = static_cast<std::uint16_t>(std::stoul(v));
+            else if (const char* v = value("--memory")) opts.memory_mib = std::stoull(v);
+            else if (const char* v = value("--workers")) opts.server.workers = std::stoull(v);
+            else throw std::invalid_argument{"Unknown argument: " + arg};
+        }
+        if (opts.memory_mib == 0) throw std::invalid_argument{"Memory budget must be positive."};
+        return opts;
+    }
+
+    // Waits for SIGINT / SIGTERM, blocked in every thread so only this one sees them
+    void WaitForShutdown(const sigset_t& signals)
+    {
+        int received = 0;
+        ::sigwait(&signals, &received);
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const options opts = ParseOptions(argc, argv);
+
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        ::pthread_sigmask(SIG_BLOCK, &signals, nullptr); // inherited by the workers
+
+        node_cache cache{opts.memory_mib << 20};
+        caches::cache_server<node_cache> server{cache, opts.server};
+        server.Start();
+        std::printf("cache_server: %zu workers on %s:%u, %zu MiB\n", server.Workers(), opts.server.address.c_str(),
+                    static_cast<unsigned>(server.Port()), opts.memory_mib);
+        std::fflush(stdout);
+
+        WaitForShutdown(signals);
+        server.Stop();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "cache_server: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+#ifndef SET_ASSOCIATIVE_CACHE_HPP
+#define SET_ASSOCIATIVE_CACHE_HPP
+
+#include "flat_hash_map.hpp"
+#include "hash_util.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace caches
+{
+    /*
+     * Set-associative cache, organized like a hardware cache. A key hashes
+     * to exactly one set of Ways entries; the set's tags (7 hash bits each)
+     * are matched with one SIMD compare and at most the matching ways' keys
+     * are read. The victim is the empty way, else the tree-PLRU choice
+     * (Ways - 1 bits per set), so an operation touches one set and nothing
+     * else: no global list, no allocation after construction, and a bounded
+     * probe. Hot keys that collide in one set can evict each other, which
+     * costs some hit ratio compared to a global LRU.
+     * Key - Type of the key (default-constructible, copy-assignable)
+     * Value - Type of value (default-constructible, copy-assignable)
+     * Ways - Associativity, 8 or 16
+     * Hash / KeyEqual - Hasher and equality of Key
+     */
+    template <typename Key, typename Value, std::size_t Ways = 16, typename Hash = std::hash<Key>,
+              typename KeyEqual = std::equal_to<Key>>
+    class set_associative_cache
+    {
+        static_assert(Ways == 8 || Ways == 16, "set_associative_cache supports 8- and 16-way sets.");
+
+        // Bit w set for way w
+        static constexpr std::uint32_t ways_mask = (1u << Ways) - 1;
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+        static constexpr std::size_t ways = Ways;
+
+        /*
+         * Constructor
+         * max_size - Number of elements; rounded up to a power-of-two number
+         *            of sets (see MaxSize)
+         */
+        explicit set_associative_cache(std::size_t max_size)
+        {
+            if (max_size == 0)
+            {
+                throw std::invalid_argument{"Cache size must be greater than zero."};
+            }
+            set_count = 1;
+            while (set_count * Ways < max_size) set_count *= 2;
+
+            // A set's tags are loaded as a whole group; 8-way sets read into
+            // the next set (masked off), so pad the last one
+            tags.reset(new std::int8_t[set_count * Ways + detail::group_width - Ways]);
+            keys.reset(new Key[set_count * Ways]);
+            values.reset(new Value[set_count * Ways]);
+            plru.reset(new std::uint16_t[set_count]);
+            Clear();
+        }
+
+        // Adds or updates an entry; may evict another entry of the same set
+        void Put(const Key& key, const Value& value)
+        {
+            const std::uint64_t hash = HashOf(key);
+            const std::size_t set = SetOf(hash);
+            std::size_t way = Find(set, key, hash);
+            if (way == Ways)
+            {
+                const detail::group_mask empty = Tags(set).match_empty().masked(ways_mask);
+                if (empty)
+                {
+                    way = empty.lowest();
+                    ++size;
+                }
+                else
+                {
+                    way = Victim(set);
+                }
+                tags[set * Ways + way] = H2(hash);
+                keys[set * Ways + way] = key;
+            }
+            values[set * Ways + way] = value;
+            Touch(set, way);
+        }
+
+        // Copy of the value; nullopt on a miss
+        std::optional<Value> TryGet(const Key& key)
+        {
+            const std::uint64_t hash = HashOf(key);
+            const std::size_t set = SetOf(hash);
+            const std::size_t way = Find(set, key, hash);
+            if (way == Ways) return std::nullopt;
+            Touch(set, way);
+            return values[set * Ways + way];
+        }
+
+        // Get value by key, throws if key not found. The reference is valid
+        // until the next Put of the same set.
+        const Value& Get(const Key& key)
+        {
+            const std::uint64_t hash = HashOf(key);
+            const std::size_t set = SetOf(hash);
+            const std::size_t way = Find(set, key, hash);
+            if (way == Ways)
+            {
+                throw std::range_error("Key not found in cache.");
+            }
+            Touch(set, way);
+            return values[set * Ways + way];
+        }
+
+        // Whether key is present; doesn't change the replacement state
+        bool Cached(const Key& key) const
+        {
+            const std::uint64_t hash = HashOf(key);
+            return Find(SetOf(hash), key, hash) != Ways;
+        }
+
+        // Remove a key, return true if it existed
+        bool Remove(const Key& key)
+        {
+            const std::uint64_t hash = HashOf(key);
+            const std::size_t set = SetOf(hash);
+            const std::size_t way = Find(set, key, hash);
+            if (way == Ways) return false;
+            tags[set * Ways + way] = detail::ctrl_empty;
+            --size;
+            return true;
+        }
+
+        void Clear() noexcept
+        {
+            std::memset(tags.get(), static_cast<unsigned char>(detail::ctrl_empty),
+                        set_count * Ways + detail::group_width - Ways);
+            std::memset(plru.get(), 0, set_count * sizeof(std::uint16_t));
+            size = 0;
+        }
+
+        std::size_t Size() const noexcept { return size; }
+
+        // Capacity actually provided: sets * Ways
+        std::size_t MaxSize() const noexcept { return set_count * Ways; }
+
+    private:
+        static std::uint64_t HashOf(const Key& key)
+        {
+            return mix_hash(static_cast<std::uint64_t>(Hash{}(key)));
+        }
+
+        static std::int8_t H2(std::uint64_t hash) noexcept { return static_cast<std::int8_t>(hash & 0x7F); }
+        std::size_t SetOf(std::uint64_t hash) const noexcept
+        {
+            return static_cast<std::size_t>(hash >> 7) & (set_count - 1);
+        }
+
+        detail::ctrl_group Tags(std::size_t set) const noexcept { return detail::ctrl_group{tags.get() + set * Ways}; }
+
+        // Way holding key, or Ways
+        std::size_t Find(std::size_t set, const Key& key, std::uint64_t hash) const
+        {
+            for (auto match = Tags(set).match(H2(hash)).masked(ways_mask); match; match.clear_lowest())
+            {
+                const std::size_t way = match.lowest();
+                if (KeyEqual{}(keys[set * Ways + way], key)) return way;
+            }
+            return Ways;
+        }
+
+        /*
+         * Tree-PLRU: the Ways - 1 bits of a set form a binary tree over its
+         * ways (node n has children 2n + 1 and 2n + 2); each bit points to
+         * the half that was used less recently.
+         */
+        void Touch(std::size_t set, std::size_t way) noexcept
+        {
+            std::uint16_t bits = plru[set];
+            std::size_t node = 0;
+            for (std::size_t half = Ways / 2; half > 0; half /= 2)
+            {
+                const bool right = (way & half) != 0;
+                if (right) bits &= static_cast<std::uint16_t>(~(1u << node)); // left is older now
+                else bits |= static_cast<std::uint16_t>(1u << node);
+                node = 2 * node + 1 + (right ? 1 : 0);
+            }
+            plru[set] = bits;
+        }
+
+        std::size_t Victim(std::size_t set) const noexcept
+        {
+            const std::uint16_t bits = plru[set];
+            std::size_t node = 0;
+            std::size_t way = 0;
+            for (std::size_t half = Ways / 2; half > 0; half /= 2)
+            {
+                const bool right = (bits >> node) & 1u;
+                if (right) way |= half;
+                node = 2 * node + 1 + (right ? 1 : 0);
+            }
+            return way;
+        }
+
+        std::size_t set_count = 0;
+        std::size_t size = 0;
+        std::unique_ptr<std::int8_t[]> tags; // Ways per set, ctrl_empty when free
+        std::unique_ptr<Key[]> keys;
+        std::unique_ptr<Value[]> values;
+        std::unique_ptr<std::uint16_t[]> plru;
+    };
+} // namespace caches
+
+#endif
@@ -0,0 +1,645 @@
+#ifndef SHARDED_CACHE_HPP
+#define SHARDED_CACHE_HPP
+
+#include "cache.hpp"
+#include "hash_util.hpp"
+#include "numa.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace caches
+{
+    namespace detail
+    {
+        // Forward iterator over an array of pointers that yields the pointees;
+        // lets a batch be regrouped by shard without copying keys or values
+        template <typename T>
+        class pointee_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::remove_const_t<T>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+
+            pointee_iterator() = default;
+            explicit pointee_iterator(T* const* pos) noexcept : pos{pos} {}
+
+            reference operator*() const noexcept { return **pos; }
+            pointer operator->() const noexcept { return *pos; }
+
+            pointee_iterator& operator++() noexcept
+            {
+                ++pos;
+                return *this;
+            }
+
+            pointee_iterator operator++(int) noexcept
+            {
+                pointee_iterator old = *this;
+                ++pos;
+                return old;
+            }
+
+            friend bool operator==(const pointee_iterator& a, const pointee_iterator& b) noexcept { return a.pos == b.pos; }
+            friend bool operator!=(const pointee_iterator& a, const pointee_iterator& b) noexcept { return a.pos != b.pos; }
+
+        private:
+            T* const* pos = nullptr;
+        };
+    } // namespace detail
+
+    // Where sharded_cache allocates its shards
+    enum class shard_placement
+    {
+        anywhere,         // on the constructing thread's node
+        spread_numa_nodes // round-robin over the NUMA nodes
+    };
+
+    /*
+     * Thread-safe cache that splits the key space over Shards independent
+     * fixed_sized_cache instances, each guarded by its own mutex.
+     * When the policy has a concurrent Touch (e.g. ClockCachePolicy) the shard
+     * lock is a shared_mutex and lookups only take it in shared mode, unless
+     * Stats records every access (mrc_stats), which takes the exclusive lock.
+     * Key - Type of the key (must be hashable)
+     * Value - Type of value (must be copyable, lookups return a copy)
+     * Policy - Eviction policy applied independently inside every shard
+     * Shards - Number of shards
+     * HashMap - Map container used by every shard
+     * Weigher - Entry cost function (see fixed_sized_cache)
+     * Stats - Statistics hooks kept per shard (see cache_stats.hpp)
+     * OnErase - Erase callback type, copied into every shard
+     */
+    template <typename Key, typename Value, template <typename> class Policy = NoCachePolicy,
+              std::size_t Shards = 16, typename HashMap = std::unordered_map<Key, Value>,
+              typename Weigher = unit_weigher, typename Stats = no_stats,
+              typename OnErase = std::function<void(const Key&, const Value&)>>
+    class sharded_cache
+    {
+        static_assert(Shards > 0, "sharded_cache needs at least one shard.");
+        static_assert(Shards <= (std::size_t{1} << 32), "Shard routing uses 32 bits of the hash.");
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+        using cache_type = fixed_sized_cache<Key, Value, Policy, HashMap, Weigher, Stats, OnErase>;
+        using on_erase_cb = typename cache_type::on_erase_cb;
+
+        // Lookups run under a shared lock when the policy allows concurrent
+        // hits and Stats doesn't update estimators on every access
+        static constexpr bool shared_lookups =
+            has_concurrent_touch<Policy<Key>>::value && !has_access_hook<Stats, Key>::value;
+
+        /*
+         * Constructor
+         * max_size - Total number of elements (or total weight) over all
+         *            shards; every shard gets an equal slice, the remainder
+         *            going to the first shards
+         * policy - Eviction policy, copied into every shard
+         * on_erase - Optional callback when an item is evicted; it runs while
+         *            the owning shard is locked
+         * weigher - Entry cost function, copied into every shard
+         */
+        explicit sharded_cache(
+            size_t max_size,
+            const Policy<Key>& policy = Policy<Key>{},
+            on_erase_cb on_erase = DefaultOnErase(),
+            const Weigher& weigher = Weigher{})
+            : sharded_cache{max_size, shard_placement::anywhere, policy, std::move(on_erase), weigher}
+        {
+        }
+
+        /*
+         * As above, choosing where shards are allocated. spread_numa_nodes
+         * builds shard i on NUMA node i % Nodes() (see RunOnNode), so its
+         * lock, map and policy storage sized up front are node-local.
+         */
+        sharded_cache(
+            size_t max_size,
+            shard_placement placement,
+            const Policy<Key>& policy = Policy<Key>{},
+            on_erase_cb on_erase = DefaultOnErase(),
+            const Weigher& weigher = Weigher{})
+            : max_cache_size{max_size}
+        {
+            if (max_size < Shards)
+            {
+                throw std::invalid_argument{"Cache size must be at least the number of shards."};
+            }
+
+            for (std::size_t i = 0; i < Shards; ++i)
+            {
+                const std::size_t slice = Slice(max_size, i);
+                const auto build = [&] { shards[i] = std::make_unique<shard>(slice, policy, on_erase, weigher); };
+                if (placement == shard_placement::spread_numa_nodes)
+                {
+                    RunOnNode(i, build);
+                }
+                else
+                {
+                    build();
+                }
+            }
+        }
+
+        /*
+         * Hash of key that picks its shard and that the shard's map and
+         * policy reuse (see fixed_sized_cache::KeyHash). Callers that keep it
+         * can pass it to the overloads below and skip hashing the key again.
+         */
+        static std::uint64_t KeyHash(const Key& key) noexcept(noexcept(key_hash(key)))
+        {
+            return key_hash(key);
+        }
+
+        // Adds or updates an entry
+        void Put(const Key& key, const Value& value) { Put(key, value, KeyHash(key)); }
+
+        // Put with hash == KeyHash(key) already computed
+        void Put(const Key& key, const Value& value, std::uint64_t hash)
+        {
+            shard& s = *shards[ShardOf(hash)];
+            std::lock_guard<mutex_type> guard{s.lock};
+            s.cache.Put(key, value, hash);
+        }
+
+        // Try to get a copy of the element by key
+        std::optional<Value> TryGet(const Key& key) { return TryGet(key, KeyHash(key)); }
+
+        // TryGet with hash == KeyHash(key) already computed
+        std::optional<Value> TryGet(const Key& key, std::uint64_t hash)
+        {
+            shard& s = *shards[ShardOf(hash)];
+            read_lock guard{s.lock};
+            auto result = s.cache.TryGet(key, hash);
+            if (!result.second)
+            {
+                return std::nullopt;
+            }
+            return result.first->second;
+        }
+
+        // Get a copy of the value by key, throws if key not found
+        Value Get(const Key& key)
+        {
+            auto result = TryGet(key);
+            if (!result)
+            {
+                throw std::range_error("Key not found in cache.");
+            }
+            return *std::move(result);
+        }
+
+        /*
+         * Returns a copy of the cached value for key, or loads it with
+         * loader(key) and caches it. Loads are single-flight: while one caller
+         * runs the loader for a key, every other caller missing the same key
+         * waits for that result instead of starting its own load. A loader
+         * exception is rethrown to all of them and nothing is cached. The
+         * loader runs without any shard lock held.
+         */
+        template <typename Loader>
+        Value GetOrLoad(const Key& key, Loader&& loader)
+        {
+            shard& s = ShardFor(key);
+            load_ticket ticket = JoinLoad(s, key);
+            if (ticket.cached)
+            {
+                return *std::move(ticket.cached);
+            }
+            if (ticket.promise)
+            {
+                RunLoad(s, key, *ticket.promise, loader);
+            }
+            return ticket.pending.get();
+        }
+
+        /*
+         * Non-blocking GetOrLoad. A hit returns a ready future. A miss joins
+         * the load already in flight for key, or starts one by calling
+         * executor(task), where task is a copyable void() callable that runs
+         * the loader and completes the future. The executor decides where the
+         * task runs (a thread pool, the event loop, a new thread). The cache
+         * must outlive the task.
+         */
+        template <typename Loader, typename Executor>
+        std::shared_future<Value> GetOrLoadAsync(const Key& key, Loader loader, Executor&& executor)
+        {
+            shard& s = ShardFor(key);
+            load_ticket ticket = JoinLoad(s, key);
+            if (ticket.cached)
+            {
+                std::promise<Value> ready;
+                ready.set_value(*std::move(ticket.cached));
+                return ready.get_future().share();
+            }
+            if (ticket.promise)
+            {
+                auto promise = ticket.promise;
+                try
+                {
+                    std::forward<Executor>(executor)([this, target = &s, key, loader = std::move(loader), promise]() mutable {
+                        RunLoad(*target, key, *promise, loader);
+                    });
+                }
+                catch (...)
+                {
+                    FailLoad(s, key, *promise);
+                    throw;
+                }
+            }
+            return ticket.pending;
+        }
+
+        /*
+         * Looks up every key of [first, last) and returns a copy of each hit,
+         * in input order. Keys are grouped by shard first, so every shard lock
+         * is taken once per batch and each shard resolves its keys with
+         * fixed_sized_cache::MultiGet.
+         */
+        template <typename ForwardIt>
+        std::vector<std::optional<Value>> MultiGet(ForwardIt first, ForwardIt last)
+        {
+            std::vector<const Key*> keys;
+            for (; first != last; ++first)
+            {
+                keys.push_back(&static_cast<const Key&>(*first));
+            }
+
+            shard_bounds bounds;
+            const std::vector<std::size_t> positions = GroupByShard(Iota(keys.size()), bounds,
+                                                                    [&](std::size_t i) -> const Key& { return *keys[i]; });
+            std::vector<const Key*> grouped(keys.size());
+            for (std::size_t j = 0; j < positions.size(); ++j)
+            {
+                grouped[j] = keys[positions[j]];
+            }
+
+            std::vector<std::optional<Value>> values(keys.size());
+            std::vector<std::pair<typename cache_type::const_iterator, bool>> found;
+            for (std::size_t i = 0; i < Shards; ++i)
+            {
+                if (bounds[i] == bounds[i + 1]) continue;
+
+                shard& s = *shards[i];
+                read_lock guard{s.lock};
+                found.clear();
+                s.cache.MultiGet(detail::pointee_iterator<const Key>{grouped.data() + bounds[i]},
+                                 detail::pointee_iterator<const Key>{grouped.data() + bounds[i + 1]},
+                                 std::back_inserter(found));
+                for (std::size_t j = 0; j < found.size(); ++j)
+                {
+                    if (found[j].second) values[positions[bounds[i] + j]] = found[j].first->second;
+                }
+            }
+            return values;
+        }
+
+        // Puts every (key, value) pair of [first, last), locking each shard once
+        template <typename ForwardIt>
+        void MultiPut(ForwardIt first, ForwardIt last)
+        {
+            using entry_type = typename std::iterator_traits<ForwardIt>::value_type;
+
+            std::vector<const entry_type*> entries;
+            for (; first != last; ++first)
+            {
+                entries.push_back(&static_cast<const entry_type&>(*first));
+            }
+
+            shard_bounds bounds;
+            const std::vector<const entry_type*> grouped = GroupByShard(entries, bounds,
+                                                                        [](const entry_type* entry) -> const Key& { return entry->first; });
+            for (std::size_t i = 0; i < Shards; ++i)
+            {
+                if (bounds[i] == bounds[i + 1]) continue;
+
+                shard& s = *shards[i];
+                std::lock_guard<mutex_type> guard{s.lock};
+                s.cache.MultiPut(detail::pointee_iterator<const entry_type>{grouped.data() + bounds[i]},
+                                 detail::pointee_iterator<const entry_type>{grouped.data() + bounds[i + 1]});
+            }
+        }
+
+        // Check if a key exists
+        bool Cached(const Key& key) const { return Cached(key, KeyHash(key)); }
+
+        bool Cached(const Key& key, std::uint64_t hash) const
+        {
+            const shard& s = *shards[ShardOf(hash)];
+            read_lock guard{s.lock};
+            return s.cache.Cached(key, hash);
+        }
+
+        // Return number of entries over all shards
+        std::size_t Size() const
+        {
+            std::size_t total = 0;
+            for (const auto& s : shards)
+            {
+                read_lock guard{s->lock};
+                total += s->cache.Size();
+            }
+            return total;
+        }
+
+        // Summed entry weight over all shards
+        std::size_t Weight() const
+        {
+            std::size_t total = 0;
+            for (const auto& s : shards)
+            {
+                read_lock guard{s->lock};
+                total += s->cache.Weight();
+            }
+            return total;
+        }
+
+        // Memory breakdown summed over all shards (see fixed_sized_cache::MemoryUsage)
+        memory_usage MemoryUsage() const
+        {
+            memory_usage total;
+            for (const auto& s : shards)
+            {
+                read_lock guard{s->lock};
+                total += s->cache.MemoryUsage();
+            }
+            return total;
+        }
+
+        // Visits every entry as visit(key, value), one shard at a time and
+        // in that shard's policy order (see fixed_sized_cache::ForEach)
+        template <typename Visit>
+        void ForEach(Visit&& visit) const
+        {
+            for (const auto& s : shards)
+            {
+                read_lock guard{s->lock};
+                s->cache.ForEach(visit);
+            }
+        }
+
+        // Remove a key, return true if it existed
+        bool Remove(const Key& key) { return Remove(key, KeyHash(key)); }
+
+        bool Remove(const Key& key, std::uint64_t hash)
+        {
+            shard& s = *shards[ShardOf(hash)];
+            std::lock_guard<mutex_type> guard{s.lock};
+            return s.cache.Remove(key, hash);
+        }
+
+        // Remove everything
+        void Clear()
+        {
+            for (auto& s : shards)
+            {
+                std::lock_guard<mutex_type> guard{s->lock};
+                s->cache.Clear();
+            }
+        }
+
+        // Total capacity over all shards
+        std::size_t MaxSize() const noexcept { return max_cache_size.load(std::memory_order_relaxed); }
+
+        // Total low watermark, sliced over the shards like the capacity
+        // (see fixed_sized_cache::SetLowWatermark)
+        void SetLowWatermark(std::size_t low)
+        {
+            if (low > MaxSize())
+            {
+                throw std::invalid_argument{"Low watermark must not exceed the cache size."};
+            }
+            for (std::size_t i = 0; i < Shards; ++i)
+            {
+                std::lock_guard<mutex_type> guard{shards[i]->lock};
+                shards[i]->cache.SetLowWatermark(Slice(low, i));
+            }
+        }
+
+        /*
+         * Changes the total capacity at runtime, one shard at a time; a
+         * shrinking shard evicts under its lock (see fixed_sized_cache::Resize)
+         */
+        void Resize(std::size_t new_size)
+        {
+            if (new_size < Shards)
+            {
+                throw std::invalid_argument{"Cache size must be at least the shard count."};
+            }
+            for (std::size_t i = 0; i < Shards; ++i)
+            {
+                std::lock_guard<mutex_type> guard{shards[i]->lock};
+                shards[i]->cache.Resize(Slice(new_size, i));
+            }
+            max_cache_size.store(new_size, std::memory_order_relaxed);
+        }
+
+        /*
+         * Delivers deferred evictions of every shard (see eviction_queue).
+         * Shard locks are not taken, so OnErase::Drain must be safe to call
+         * while other threads evict, as eviction_queue's sink is.
+         */
+        template <typename C = on_erase_cb>
+        auto DrainEvictions() -> decltype(std::declval<C&>().Drain())
+        {
+            decltype(std::declval<C&>().Drain()) delivered{};
+            for (auto& s : shards)
+            {
+                delivered += s->cache.DrainEvictions();
+            }
+            return delivered;
+        }
+
+        // Statistics summed over all shards; the counters are read without
+        // taking the shard locks
+        template <typename S = Stats>
+        auto Statistics() const -> decltype(std::declval<const S&>().Snapshot())
+        {
+            decltype(std::declval<const S&>().Snapshot()) total;
+            for (const auto& s : shards)
+            {
+                total += s->cache.Statistics().Snapshot();
+            }
+            return total;
+        }
+
+        static constexpr std::size_t ShardCount() noexcept { return Shards; }
+
+    private:
+        static on_erase_cb DefaultOnErase()
+        {
+            if constexpr (std::is_same_v<on_erase_cb, std::function<void(const Key&, const Value&)>>)
+            {
+                return [](const Key&, const Value&) {};
+            }
+            else
+            {
+                return on_erase_cb{};
+            }
+        }
+
+        using mutex_type = std::conditional_t<shared_lookups, std::shared_mutex, std::mutex>;
+        using read_lock = std::conditional_t<shared_lookups, std::shared_lock<mutex_type>,
+                                             std::unique_lock<mutex_type>>;
+
+        // Each shard sits on its own cache line so neighbouring locks don't false-share
+        struct alignas(64) shard
+        {
+            shard(std::size_t max_size, const Policy<Key>& policy, const on_erase_cb& on_erase,
+                  const Weigher& weigher)
+                : cache{max_size, policy, on_erase, weigher}
+            {
+            }
+
+            mutable mutex_type lock;
+            cache_type cache;
+            std::unordered_map<Key, std::shared_future<Value>> loads; // GetOrLoad calls in flight
+        };
+
+        // Outcome of joining a load: a hit, or the future of the load in
+        // flight, plus the promise to complete if this caller started it
+        struct load_ticket
+        {
+            std::optional<Value> cached;
+            std::shared_future<Value> pending;
+            std::shared_ptr<std::promise<Value>> promise;
+        };
+
+        static load_ticket JoinLoad(shard& s, const Key& key)
+        {
+            load_ticket ticket;
+            std::lock_guard<mutex_type> guard{s.lock};
+
+            auto result = s.cache.TryGet(key);
+            if (result.second)
+            {
+                ticket.cached = result.first->second;
+                return ticket;
+            }
+
+            auto in_flight = s.loads.find(key);
+            if (in_flight != s.loads.end())
+            {
+                ticket.pending = in_flight->second;
+                return ticket;
+            }
+
+            ticket.promise = std::make_shared<std::promise<Value>>();
+            ticket.pending = ticket.promise->get_future().share();
+            s.loads.emplace(key, ticket.pending);
+            return ticket;
+        }
+
+        // The value is cached and the load retired under one lock, so later
+        // callers either hit or still find the load in flight
+        template <typename Loader>
+        static void RunLoad(shard& s, const Key& key, std::promise<Value>& promise, Loader& loader)
+        {
+            std::optional<Value> value;
+            try
+            {
+                value.emplace(loader(key));
+            }
+            catch (...)
+            {
+                FailLoad(s, key, promise);
+                return;
+            }
+
+            {
+                std::lock_guard<mutex_type> guard{s.lock};
+                s.cache.Put(key, *value);
+                s.loads.erase(key);
+            }
+            promise.set_value(*std::move(value));
+        }
+
+        static void FailLoad(shard& s, const Key& key, std::promise<Value>& promise)
+        {
+            {
+                std::lock_guard<mutex_type> guard{s.lock};
+                s.loads.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+        }
+
+        static std::size_t ShardIndex(const Key& key) noexcept { return ShardOf(KeyHash(key)); }
+
+        // Routes on the high word (multiply-shift): the shards' own tables
+        // use the low bits of the same hash (flat_hash_map's H2 tag and
+        // group index, key_pool's home slot), which `hash % Shards` would
+        // make constant within a shard
+        static constexpr std::size_t ShardOf(std::uint64_t hash) noexcept
+        {
+            return static_cast<std::size_t>(((hash >> 32) * Shards) >> 32);
+        }
+
+        // bounds[i]..bounds[i + 1] is shard i's run in a grouped batch
+        using shard_bounds = std::array<std::size_t, Shards + 1>;
+
+        // Stable counting sort of items by the shard of key_of(item)
+        template <typename T, typename KeyOf>
+        static std::vector<T> GroupByShard(const std::vector<T>& items, shard_bounds& bounds, KeyOf key_of)
+        {
+            std::vector<std::size_t> shard_of(items.size());
+            bounds.fill(0);
+            for (std::size_t i = 0; i < items.size(); ++i)
+            {
+                shard_of[i] = ShardIndex(key_of(items[i]));
+                ++bounds[shard_of[i] + 1];
+            }
+            for (std::size_t i = 0; i < Shards; ++i)
+            {
+                bounds[i + 1] += bounds[i];
+            }
+
+            std::array<std::size_t, Shards> cursor;
+            std::copy(bounds.begin(), bounds.end() - 1, cursor.begin());
+            std::vector<T> grouped(items.size());
+            for (std::size_t i = 0; i < items.size(); ++i)
+            {
+                grouped[cursor[shard_of[i]]++] = items[i];
+            }
+            return grouped;
+        }
+
+        static std::vector<std::size_t> Iota(std::size_t count)
+        {
+            std::vector<std::size_t> indices(count);
+            for (std::size_t i = 0; i < count; ++i) indices[i] = i;
+            return indices;
+        }
+
+        // Shard i's part of a total: an equal slice, the remainder going to the first shards
+        static std::size_t Slice(std::size_t total, std::size_t i) noexcept
+        {
+            return total / Shards + (i < total % Shards ? 1 : 0);
+        }
+
+        shard& ShardFor(const Key& key) noexcept { return *shards[ShardIndex(key)]; }
+        const shard& ShardFor(const Key& key) const noexcept { return *shards[ShardIndex(key)]; }
+
+        std::array<std::unique_ptr<shard>, Shards> shards;
+        std::atomic<std::size_t> max_cache_size;
+    };
+} // namespace caches
+
+#endif
@@ -0,0 +1,500 @@
+#ifndef SHM_CACHE_HPP
+#define SHM_CACHE_HPP
+
+#include "cache_stats.hpp"
+#include "hash_util.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace caches
+{
+    // How shm_cache attaches to its shared-memory object
+    enum class shm_mode
+    {
+        create,        // create it; fail if it already exists
+        open,          // attach to an existing one
+        open_or_create // attach, creating it on first use
+    };
+
+    /*
+     * LRU cache kept in a POSIX shared-memory object, so that several
+     * processes (e.g. pre-forked workers) share one copy of the entries.
+     * The whole cache - header, bucket array and entry slots - lives in one
+     * mapping and links its parts by slot index rather than pointer, so every
+     * process may map it at a different address. Keys and values are stored
+     * by value and must be trivially copyable; lookups return a copy.
+     * Every operation takes one process-shared, robust mutex. If a process
+     * dies while holding it, the next process to lock it empties the cache,
+     * since the dead process may have left the lists half-updated.
+     * All processes must agree on Key, Value and Hash (the same binary, in
+     * practice); the capacity and entry layout are checked on attach.
+     * Key - Type of the key (trivially copyable, equality comparable)
+     * Value - Type of value (trivially copyable)
+     * Hash - Hash of Key; must give the same result in every process
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class shm_cache
+    {
+        static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+                      "shm_cache stores keys and values by value in shared memory.");
+        static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+                      "shm_cache needs lock-free atomics to publish the shared header.");
+
+        using index_type = std::uint32_t;
+        static constexpr index_type npos = ~index_type{0};
+
+        struct node
+        {
+            Key key;
+            Value value;
+            std::uint32_t hash; // low bits of the key's hash
+            index_type chain;   // next slot in the same bucket, or in the free list
+            index_type prev;    // LRU neighbours
+            index_type next;
+        };
+
+        static constexpr std::uint32_t initializing = 0;
+        static constexpr std::uint32_t ready = 1;
+
+        struct header
+        {
+            std::atomic<std::uint32_t> state; // zero-filled by ftruncate, so starts initializing
+            char magic[8];
+            std::uint32_t version;
+            std::uint64_t key_size;
+            std::uint64_t value_size;
+            std::uint64_t node_size;
+            std::uint64_t capacity;
+            std::uint64_t bucket_count;
+            pthread_mutex_t lock;
+
+            std::uint64_t size;
+            index_type free_head;
+            index_type lru_head; // most recently used
+            index_type lru_tail;
+
+            std::uint64_t hits;
+            std::uint64_t misses;
+            std::uint64_t inserts;
+            std::uint64_t updates;
+            std::uint64_t evictions;
+        };
+
+        static constexpr char region_magic[8] = {'M', 'C', 'S', 'H', 'M', '\0', '\0', '\0'};
+        static constexpr std::uint32_t region_version = 1;
+
+        static constexpr std::size_t AlignUp(std::size_t n, std::size_t alignment) noexcept
+        {
+            return (n + alignment - 1) / alignment * alignment;
+        }
+
+        static constexpr std::size_t region_alignment = alignof(node) > 64 ? alignof(node) : 64;
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+
+        /*
+         * Maps the shared-memory object `name` (e.g. "/myapp-cache").
+         * capacity - Maximum number of entries; must match the object's when
+         *            attaching to an existing one
+         * mode - Whether to create the object, attach to it, or either
+         * Throws std::system_error when the object cannot be opened or
+         * mapped, and std::runtime_error when an existing object has a
+         * different capacity or entry layout.
+         */
+        shm_cache(const std::string& name, std::size_t capacity, shm_mode mode = shm_mode::open_or_create)
+        {
+            if (capacity == 0 || capacity >= npos)
+            {
+                throw std::invalid_argument{"Shared cache capacity must be between 1 and 2^32 - 2."};
+            }
+
+            std::size_t buckets = 1;
+            while (buckets < capacity) buckets *= 2;
+            const std::size_t buckets_offset = AlignUp(sizeof(header), region_alignment);
+            const std::size_t nodes_offset = AlignUp(buckets_offset + buckets * sizeof(index_type), region_alignment);
+            const std::size_t total = nodes_offset + capacity * sizeof(node);
+
+            bool created = false;
+            int fd = -1;
+            if (mode != shm_mode::open)
+            {
+                fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+                created = fd >= 0;
+                if (!created && (errno != EEXIST || mode == shm_mode::create))
+                {
+                    throw std::system_error{errno, std::generic_category(), "Cannot create shared cache " + name};
+                }
+            }
+            if (!created)
+            {
+                fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+                if (fd < 0)
+                {
+                    throw std::system_error{errno, std::generic_category(), "Cannot open shared cache " + name};
+                }
+            }
+
+            try
+            {
+                if (created)
+                {
+                    if (::ftruncate(fd, static_cast<off_t>(total)) != 0)
+                    {
+                        throw std::system_error{errno, std::generic_category(), "Cannot size shared cache " + name};
+                    }
+                }
+                else
+                {
+                    WaitForSize(fd, total, name);
+                }
+                Map(fd, total, name);
+            }
+            catch (...)
+            {
+                ::close(fd);
+                if (created) ::shm_unlink(name.c_str());
+                throw;
+            }
+            ::close(fd);
+
+            region = static_cast<header*>(mapping);
+            bucket_heads = reinterpret_cast<index_type*>(static_cast<char*>(mapping) + buckets_offset);
+            nodes = reinterpret_cast<node*>(static_cast<char*>(mapping) + nodes_offset);
+
+            try
+            {
+                if (created)
+                {
+                    Initialize(capacity, buckets);
+                }
+                else
+                {
+                    Attach(capacity, buckets, name);
+                }
+            }
+            catch (...)
+            {
+                ::munmap(mapping, mapping_size);
+                if (created) ::shm_unlink(name.c_str());
+                throw;
+            }
+        }
+
+        shm_cache(const shm_cache&) = delete;
+        shm_cache& operator=(const shm_cache&) = delete;
+
+        // Unmaps the cache; the shared object stays until Unlink
+        ~shm_cache() { ::munmap(mapping, mapping_size); }
+
+        // Removes the shared object's name; mapped caches keep working
+        static bool Unlink(const std::string& name) noexcept { return ::shm_unlink(name.c_str()) == 0; }
+
+        void Put(const Key& key, const Value& value)
+        {
+            const std::uint64_t hash = HashOf(key);
+            region_guard guard{*this};
+
+            index_type id = Find(key, hash);
+            if (id != npos)
+            {
+                nodes[id].value = value;
+                MoveToFront(id);
+                ++region->updates;
+                return;
+            }
+
+            if (region->free_head != npos)
+            {
+                id = region->free_head;
+                region->free_head = nodes[id].chain;
+                ++region->size;
+            }
+            else
+            {
+                id = region->lru_tail;
+                Unlink(id);
+                Unchain(id);
+                ++region->evictions;
+            }
+
+            node& n = nodes[id];
+            n.key = key;
+            n.value = value;
+            n.hash = static_cast<std::uint32_t>(hash);
+            index_type& head = bucket_heads[hash & (region->bucket_count - 1)];
+            n.chain = head;
+            head = id;
+            PushFront(id);
+            ++region->inserts;
+        }
+
+        // Copy of the value, marking it most recently used; nullopt on a miss
+        std::optional<Value> TryGet(const Key& key)
+        {
+            const std::uint64_t hash = HashOf(key);
+            region_guard guard{*this};
+
+            const index_type id = Find(key, hash);
+            if (id == npos)
+            {
+                ++region->misses;
+                return std::nullopt;
+            }
+            ++region->hits;
+            MoveToFront(id);
+            return nodes[id].value;
+        }
+
+        // Whether key is resident; doesn't change its recency
+        bool Cached(const Key& key) const
+        {
+            const std::uint64_t hash = HashOf(key);
+            region_guard guard{*this};
+            return Find(key, hash) != npos;
+        }
+
+        // Remove a key, return true if it existed
+        bool Remove(const Key& key)
+        {
+            const std::uint64_t hash = HashOf(key);
+            region_guard guard{*this};
+
+            const index_type id = Find(key, hash);
+            if (id == npos) return false;
+
+            Unlink(id);
+            Unchain(id);
+            nodes[id].chain = region->free_head;
+            region->free_head = id;
+            --region->size;
+            return true;
+        }
+
+        void Clear()
+        {
+            region_guard guard{*this};
+            Reset();
+        }
+
+        std::size_t Size() const
+        {
+            region_guard guard{*this};
+            return static_cast<std::size_t>(region->size);
+        }
+
+        std::size_t MaxSize() const noexcept { return static_cast<std::size_t>(region->capacity); }
+
+        // Counters shared by every attached process
+        cache_stats_snapshot Statistics() const
+        {
+            region_guard guard{*this};
+            cache_stats_snapshot snapshot;
+            snapshot.hits = region->hits;
+            snapshot.misses = region->misses;
+            snapshot.inserts = region->inserts;
+            snapshot.updates = region->updates;
+            snapshot.evictions = region->evictions;
+            return snapshot;
+        }
+
+    private:
+        // Holds the region mutex; recovers the cache if its last owner died
+        class region_guard
+        {
+        public:
+            explicit region_guard(const shm_cache& cache) : lock{&cache.region->lock}
+            {
+                const int rc = ::pthread_mutex_lock(lock);
+                if (rc == EOWNERDEAD)
+                {
+                    cache.Reset();
+                    ::pthread_mutex_consistent(lock);
+                }
+                else if (rc != 0)
+                {
+                    throw std::system_error{rc, std::generic_category(), "Cannot lock shared cache"};
+                }
+            }
+
+            region_guard(const region_guard&) = delete;
+            region_guard& operator=(const region_guard&) = delete;
+
+            ~region_guard() { ::pthread_mutex_unlock(lock); }
+
+        private:
+            pthread_mutex_t* lock;
+        };
+
+        static std::uint64_t HashOf(const Key& key) noexcept(noexcept(Hash{}(key)))
+        {
+            return mix_hash(static_cast<std::uint64_t>(Hash{}(key)));
+        }
+
+        // The creator sizes the object right after creating it
+        static void WaitForSize(int fd, std::size_t total, const std::string& name)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + attach_timeout;
+            for (;;)
+            {
+                struct stat info;
+                if (::fstat(fd, &info) != 0)
+                {
+                    throw std::system_error{errno, std::generic_category(), "Cannot stat shared cache " + name};
+                }
+                if (static_cast<std::size_t>(info.st_size) == total) return;
+                if (info.st_size != 0 || std::chrono::steady_clock::now() > deadline)
+                {
+                    throw std::runtime_error{"Shared cache " + name + " has a different capacity or layout."};
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        void Map(int fd, std::size_t total, const std::string& name)
+        {
+            void* mapped = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                throw std::system_error{errno, std::generic_category(), "Cannot map shared cache " + name};
+            }
+            mapping = mapped;
+            mapping_size = total;
+        }
+
+        void Initialize(std::size_t capacity, std::size_t buckets)
+        {
+            header* h = new (mapping) header{};
+            std::memcpy(h->magic, region_magic, sizeof(region_magic));
+            h->version = region_version;
+            h->key_size = sizeof(Key);
+            h->value_size = sizeof(Value);
+            h->node_size = sizeof(node);
+            h->capacity = capacity;
+            h->bucket_count = buckets;
+
+            pthread_mutexattr_t attributes;
+            ::pthread_mutexattr_init(&attributes);
+            ::pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+            ::pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+            const int rc = ::pthread_mutex_init(&h->lock, &attributes);
+            ::pthread_mutexattr_destroy(&attributes);
+            if (rc != 0)
+            {
+                throw std::system_error{rc, std::generic_category(), "Cannot initialize shared cache lock"};
+            }
+
+            region = h;
+            Reset();
+            h->state.store(ready, std::memory_order_release);
+        }
+
+        void Attach(std::size_t capacity, std::size_t buckets, const std::string& name)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + attach_timeout;
+            while (region->state.load(std::memory_order_acquire) != ready)
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    throw std::runtime_error{"Shared cache " + name + " was never initialized."};
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            if (std::memcmp(region->magic, region_magic, sizeof(region_magic)) != 0 ||
+                region->version != region_version || region->key_size != sizeof(Key) ||
+                region->value_size != sizeof(Value) || region->node_size != sizeof(node) ||
+                region->capacity != capacity || region->bucket_count != buckets)
+            {
+                throw std::runtime_error{"Shared cache " + name + " has a different capacity or layout."};
+            }
+        }
+
+        // Empties every list; the caller holds the lock (or is the creator)
+        void Reset() const noexcept
+        {
+            for (std::uint64_t b = 0; b < region->bucket_count; ++b) bucket_heads[b] = npos;
+            for (std::uint64_t i = 0; i < region->capacity; ++i)
+            {
+                nodes[i].chain = i + 1 < region->capacity ? static_cast<index_type>(i + 1) : npos;
+            }
+            region->free_head = 0;
+            region->lru_head = npos;
+            region->lru_tail = npos;
+            region->size = 0;
+        }
+
+        index_type Find(const Key& key, std::uint64_t hash) const noexcept
+        {
+            const auto tag = static_cast<std::uint32_t>(hash);
+            for (index_type id = bucket_heads[hash & (region->bucket_count - 1)]; id != npos; id = nodes[id].chain)
+            {
+                if (nodes[id].hash == tag && nodes[id].key == key) return id;
+            }
+            return npos;
+        }
+
+        // Drops a resident slot from its bucket chain
+        void Unchain(index_type id) noexcept
+        {
+            index_type* link = &bucket_heads[HashOf(nodes[id].key) & (region->bucket_count - 1)];
+            while (*link != id) link = &nodes[*link].chain;
+            *link = nodes[id].chain;
+        }
+
+        void PushFront(index_type id) noexcept
+        {
+            node& n = nodes[id];
+            n.prev = npos;
+            n.next = region->lru_head;
+            if (region->lru_head != npos) nodes[region->lru_head].prev = id;
+            else region->lru_tail = id;
+            region->lru_head = id;
+        }
+
+        void Unlink(index_type id) noexcept
+        {
+            node& n = nodes[id];
+            if (n.prev != npos) nodes[n.prev].next = n.next;
+            else region->lru_head = n.next;
+            if (n.next != npos) nodes[n.next].prev = n.prev;
+            else region->lru_tail = n.prev;
+        }
+
+        void MoveToFront(index_type id) noexcept
+        {
+            if (region->lru_head == id) return;
+            Unlink(id);
+            PushFront(id);
+        }
+
+        static constexpr std::chrono::seconds attach_timeout{5};
+
+        void* mapping = nullptr;
+        std::size_t mapping_size = 0;
+        header* region = nullptr;
+        index_type* bucket_heads = nullptr;
+        node* nodes = nullptr;
+    };
+} // namespace caches
+
+#endif
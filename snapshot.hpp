@@ -0,0 +1,356 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CACHES_SNAPSHOT_MMAP 1
+#endif
+
+namespace caches
+{
+    /*
+     * How SaveSnapshot / LoadSnapshot turn a key or value into bytes.
+     * Trivially copyable types and std::string are handled here; for other
+     * types specialize snapshot_codec<T> with:
+     *
+     *   static constexpr std::size_t fixed_size;    // bytes per item, 0 if it varies
+     *   static std::size_t Size(const T& item);     // bytes Encode writes
+     *   static void Encode(const T& item, char* out);
+     *   static T Decode(const char* in, std::size_t size);
+     *
+     * The bytes are stored as they are in memory, so a snapshot of
+     * trivially copyable types only loads on a machine with the same byte
+     * order and layout (the header checks the byte order and sizes).
+     */
+    template <typename T, typename = void>
+    struct snapshot_codec;
+
+    template <typename T>
+    struct snapshot_codec<T, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+    {
+        static constexpr std::size_t fixed_size = sizeof(T);
+
+        static std::size_t Size(const T&) noexcept { return sizeof(T); }
+        static void Encode(const T& item, char* out) noexcept { std::memcpy(out, &item, sizeof(T)); }
+
+        static T Decode(const char* in, std::size_t) noexcept
+        {
+            T item;
+            std::memcpy(&item, in, sizeof(T));
+            return item;
+        }
+    };
+
+    template <>
+    struct snapshot_codec<std::string>
+    {
+        static constexpr std::size_t fixed_size = 0;
+
+        static std::size_t Size(const std::string& item) noexcept { return item.size(); }
+        static void Encode(const std::string& item, char* out) noexcept { std::memcpy(out, item.data(), item.size()); }
+        static std::string Decode(const char* in, std::size_t size) { return std::string(in, size); }
+    };
+
+    namespace detail
+    {
+        /*
+         * File layout: this header, then `count` records. A record is the
+         * encoded key followed by the encoded value; a side whose size
+         * varies is prefixed with its length as a u32.
+         */
+        struct snapshot_header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order; // snapshot_byte_order as written
+            std::uint64_t key_size;   // snapshot_codec<Key>::fixed_size
+            std::uint64_t value_size; // snapshot_codec<Value>::fixed_size
+            std::uint64_t count;
+        };
+
+        constexpr char snapshot_magic[8] = {'M', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+        constexpr std::uint32_t snapshot_version = 1;
+        constexpr std::uint32_t snapshot_byte_order = 0x01020304;
+
+        template <typename T>
+        std::size_t EncodedSize(const T& item) noexcept
+        {
+            using codec = snapshot_codec<T>;
+            return codec::fixed_size != 0 ? codec::fixed_size : sizeof(std::uint32_t) + codec::Size(item);
+        }
+
+        template <typename T>
+        char* EncodeItem(const T& item, char* out)
+        {
+            using codec = snapshot_codec<T>;
+            if constexpr (codec::fixed_size != 0)
+            {
+                codec::Encode(item, out);
+                return out + codec::fixed_size;
+            }
+            else
+            {
+                const std::size_t size = codec::Size(item);
+                if (size > UINT32_MAX)
+                {
+                    throw std::length_error{"Snapshot item larger than 4 GiB."};
+                }
+                const auto length = static_cast<std::uint32_t>(size);
+                std::memcpy(out, &length, sizeof(length));
+                codec::Encode(item, out + sizeof(length));
+                return out + sizeof(length) + size;
+            }
+        }
+
+        template <typename T>
+        T DecodeItem(const char*& in, const char* end)
+        {
+            using codec = snapshot_codec<T>;
+            std::size_t size = codec::fixed_size;
+            if constexpr (codec::fixed_size == 0)
+            {
+                std::uint32_t length;
+                if (static_cast<std::size_t>(end - in) < sizeof(length))
+                {
+                    throw std::runtime_error{"Snapshot is truncated."};
+                }
+                std::memcpy(&length, in, sizeof(length));
+                in += sizeof(length);
+                size = length;
+            }
+            if (static_cast<std::size_t>(end - in) < size)
+            {
+                throw std::runtime_error{"Snapshot is truncated."};
+            }
+            const char* item = in;
+            in += size;
+            return codec::Decode(item, size);
+        }
+
+        // Read-only view of a whole file: mapped where mmap exists, read otherwise
+        class snapshot_file
+        {
+        public:
+            explicit snapshot_file(const std::string& path)
+            {
+#ifdef CACHES_SNAPSHOT_MMAP
+                const int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0)
+                {
+                    throw std::runtime_error{"Cannot open snapshot " + path};
+                }
+                struct stat info;
+                if (::fstat(fd, &info) != 0)
+                {
+                    ::close(fd);
+                    throw std::runtime_error{"Cannot stat snapshot " + path};
+                }
+                length = static_cast<std::size_t>(info.st_size);
+                if (length != 0)
+                {
+                    void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (mapped == MAP_FAILED)
+                    {
+                        ::close(fd);
+                        throw std::runtime_error{"Cannot map snapshot " + path};
+                    }
+                    ::madvise(mapped, length, MADV_SEQUENTIAL);
+                    bytes = static_cast<const char*>(mapped);
+                }
+                ::close(fd);
+#else
+                std::ifstream in{path, std::ios::binary};
+                if (!in)
+                {
+                    throw std::runtime_error{"Cannot open snapshot " + path};
+                }
+                buffer.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+                bytes = buffer.data();
+                length = buffer.size();
+#endif
+            }
+
+            snapshot_file(const snapshot_file&) = delete;
+            snapshot_file& operator=(const snapshot_file&) = delete;
+
+            ~snapshot_file()
+            {
+#ifdef CACHES_SNAPSHOT_MMAP
+                if (bytes != nullptr)
+                {
+                    ::munmap(const_cast<char*>(bytes), length);
+                }
+#endif
+            }
+
+            const char* data() const noexcept { return bytes; }
+            std::size_t size() const noexcept { return length; }
+
+        private:
+            const char* bytes = nullptr;
+            std::size_t length = 0;
+#ifndef CACHES_SNAPSHOT_MMAP
+            std::vector<char> buffer;
+#endif
+        };
+
+        // Flushes a written file to the device, so a rename can't publish
+        // it before its contents are durable
+        inline bool SyncFile(const std::string& path)
+        {
+#ifdef CACHES_SNAPSHOT_MMAP
+            const int fd = ::open(path.c_str(), O_WRONLY);
+            if (fd < 0) return false;
+            const bool synced = ::fsync(fd) == 0;
+            return ::close(fd) == 0 && synced;
+#else
+            (void)path;
+            return true;
+#endif
+        }
+
+        // Makes a rename inside path's directory durable
+        inline bool SyncParentDirectory(const std::string& path)
+        {
+#ifdef CACHES_SNAPSHOT_MMAP
+            const std::size_t slash = path.find_last_of('/');
+            const std::string directory =
+                slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+            const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+            if (fd < 0) return false;
+            // Some file systems can't sync a directory (EINVAL); nothing to do there
+            const bool synced = ::fsync(fd) == 0 || errno == EINVAL;
+            ::close(fd);
+            return synced;
+#else
+            (void)path;
+            return true;
+#endif
+        }
+    } // namespace detail
+
+    /*
+     * Writes every entry of `cache` (fixed_sized_cache or sharded_cache) to
+     * `path`, in the order ForEach visits them: oldest first for LRU, FIFO
+     * and LIFO, so LoadSnapshot rebuilds their eviction order. The file is
+     * written next to `path`, synced to disk and renamed over it, and the
+     * directory is synced too, so a crash leaves either the old snapshot
+     * or the complete new one. Returns the number of entries written.
+     * A sharded_cache is written one shard at a time; Puts racing with the
+     * save land in the snapshot or not depending on the shard.
+     */
+    template <typename Cache>
+    std::size_t SaveSnapshot(const Cache& cache, const std::string& path)
+    {
+        using key_type = typename Cache::key_type;
+        using value_type = typename Cache::mapped_type;
+
+        const std::string temp_path = path + ".tmp";
+        std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+        if (!out)
+        {
+            throw std::runtime_error{"Cannot create snapshot " + temp_path};
+        }
+
+        detail::snapshot_header header{};
+        std::memcpy(header.magic, detail::snapshot_magic, sizeof(header.magic));
+        header.version = detail::snapshot_version;
+        header.byte_order = detail::snapshot_byte_order;
+        header.key_size = snapshot_codec<key_type>::fixed_size;
+        header.value_size = snapshot_codec<value_type>::fixed_size;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header)); // count patched below
+
+        std::vector<char> record;
+        cache.ForEach([&](const key_type& key, const value_type& value) {
+            record.resize(detail::EncodedSize(key) + detail::EncodedSize(value));
+            detail::EncodeItem(value, detail::EncodeItem(key, record.data()));
+            out.write(record.data(), static_cast<std::streamsize>(record.size()));
+            ++header.count;
+        });
+
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out || !detail::SyncFile(temp_path))
+        {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error{"Cannot write snapshot " + temp_path};
+        }
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error{"Cannot replace snapshot " + path};
+        }
+        if (!detail::SyncParentDirectory(path))
+        {
+            throw std::runtime_error{"Cannot sync the directory of snapshot " + path};
+        }
+        return static_cast<std::size_t>(header.count);
+    }
+
+    /*
+     * Puts every entry of the snapshot at `path` into `cache`, in saved
+     * order. The file is memory mapped and decoded in place: no buffer is
+     * allocated beyond what Put itself needs. Loading into an empty cache
+     * of the same policy restores the saved eviction order (see
+     * SaveSnapshot). A smaller cache keeps whatever its policy keeps when
+     * the entries arrive oldest first: the newest ones for LRU and FIFO,
+     * but the oldest for LIFO, which evicts the latest insert. Throws
+     * std::runtime_error when the file is not a snapshot of these key/value
+     * types (the cache is left alone) or is truncated (the entries before
+     * the damage stay loaded). Returns the number of entries loaded.
+     */
+    template <typename Cache>
+    std::size_t LoadSnapshot(Cache& cache, const std::string& path)
+    {
+        using key_type = typename Cache::key_type;
+        using value_type = typename Cache::mapped_type;
+
+        const detail::snapshot_file file{path};
+        detail::snapshot_header header;
+        if (file.size() < sizeof(header))
+        {
+            throw std::runtime_error{"Snapshot " + path + " is truncated."};
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, detail::snapshot_magic, sizeof(header.magic)) != 0 ||
+            header.version != detail::snapshot_version)
+        {
+            throw std::runtime_error{"Not a cache snapshot: " + path};
+        }
+        if (header.byte_order != detail::snapshot_byte_order ||
+            header.key_size != snapshot_codec<key_type>::fixed_size ||
+            header.value_size != snapshot_codec<value_type>::fixed_size)
+        {
+            throw std::runtime_error{"Snapshot " + path + " holds other key/value types."};
+        }
+
+        const char* in = file.data() + sizeof(header);
+        const char* end = file.data() + file.size();
+        for (std::uint64_t i = 0; i < header.count; ++i)
+        {
+            key_type key = detail::DecodeItem<key_type>(in, end);
+            value_type value = detail::DecodeItem<value_type>(in, end);
+            cache.Put(std::move(key), std::move(value));
+        }
+        return static_cast<std::size_t>(header.count);
+    }
+} // namespace caches
+
+#endif
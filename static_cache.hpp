@@ -0,0 +1,352 @@
+#ifndef STATIC_CACHE_HPP
+#define STATIC_CACHE_HPP
+
+#include "cache.hpp"
+#include "fifo_policy.hpp"
+#include "flat_hash_map.hpp"
+#include "hash_util.hpp"
+#include "lifo_policy.hpp"
+#include "lru_policy.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+namespace caches
+{
+    namespace detail
+    {
+        // How static_cache orders entries for each policy it can stand in for
+        template <template <typename> class Policy>
+        struct static_order
+        {
+            static constexpr bool supported = false;
+        };
+
+        template <>
+        struct static_order<LRUCachePolicy>
+        {
+            static constexpr bool supported = true;
+            static constexpr bool touch_on_hit = true;
+            static constexpr bool evict_newest = false;
+        };
+
+        template <>
+        struct static_order<FIFOCachePolicy>
+        {
+            static constexpr bool supported = true;
+            static constexpr bool touch_on_hit = false;
+            static constexpr bool evict_newest = false;
+        };
+
+        template <>
+        struct static_order<LIFOCachePolicy>
+        {
+            static constexpr bool supported = true;
+            static constexpr bool touch_on_hit = false;
+            static constexpr bool evict_newest = true;
+        };
+
+        // Smallest unsigned type that can index N entries plus one sentinel
+        template <std::size_t N>
+        using small_index_t = std::conditional_t<(N < 0xFF), std::uint8_t,
+                                                 std::conditional_t<(N < 0xFFFF), std::uint16_t, std::uint32_t>>;
+
+        // Hash slots for N entries: at most half full, whole groups only
+        constexpr std::size_t static_slot_count(std::size_t n)
+        {
+            std::size_t slots = group_width;
+            while (slots < 2 * n) slots *= 2;
+            return slots;
+        }
+    } // namespace detail
+
+    // Key and Value are small and trivially copyable, so static_cache can hold them
+    template <typename Key, typename Value>
+    struct is_static_cacheable
+        : std::bool_constant<std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value> &&
+                             std::is_default_constructible_v<Key> && std::is_default_constructible_v<Value> &&
+                             sizeof(Key) <= 16 && sizeof(Value) <= 64>
+    {
+    };
+
+    /*
+     * Fixed-capacity cache for small trivially copyable keys and values,
+     * with all storage inline: keys and values sit in separate arrays
+     * (structure of arrays), the recency list links entries by 8/16-bit
+     * indices, and a 16-wide group of hash tags is matched with one SIMD
+     * compare (see flat_hash_map), so a lookup usually touches one tag
+     * group and one key. Nothing is allocated after construction, there is
+     * no erase callback, and the whole cache is trivially copyable.
+     * Key / Value - see is_static_cacheable
+     * N - Capacity; storage is sized for N at compile time
+     * Policy - LRUCachePolicy, FIFOCachePolicy or LIFOCachePolicy; the order
+     *          is kept inline, the policy class itself is not used
+     * Hash / KeyEqual - Hasher and equality of Key
+     */
+    template <typename Key, typename Value, std::size_t N, template <typename> class Policy = LRUCachePolicy,
+              typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class static_cache
+    {
+        static_assert(N > 0, "static_cache needs a capacity greater than zero.");
+        static_assert(is_static_cacheable<Key, Value>::value,
+                      "static_cache holds small trivially copyable keys and values; use fixed_sized_cache.");
+        static_assert(detail::static_order<Policy>::supported,
+                      "static_cache supports LRUCachePolicy, FIFOCachePolicy and LIFOCachePolicy.");
+
+        using order = detail::static_order<Policy>;
+        using index_type = detail::small_index_t<N>;
+        static constexpr index_type none = static_cast<index_type>(N); // list sentinel and "not found"
+        static constexpr std::size_t slot_count = detail::static_slot_count(N);
+        static constexpr std::size_t npos = ~std::size_t{0};
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+        static constexpr std::size_t capacity = N;
+
+        /*
+         * Constructor
+         * max_size - Maximum number of elements, at most N
+         */
+        explicit static_cache(std::size_t max_size = N) : max_cache_size{max_size}
+        {
+            if (max_cache_size == 0)
+            {
+                throw std::invalid_argument{"Cache size must be greater than zero."};
+            }
+            if (max_cache_size > N)
+            {
+                throw std::invalid_argument{"Cache size exceeds the static capacity."};
+            }
+            Clear();
+        }
+
+        // Adds or updates an entry
+        void Put(const Key& key, const Value& value) noexcept
+        {
+            const std::uint64_t hash = HashOf(key);
+            const std::size_t pos = FindSlot(key, hash);
+            if (pos != npos)
+            {
+                const index_type id = slot_entry[pos];
+                values[id] = value;
+                if constexpr (order::touch_on_hit) MoveToFront(id);
+                return;
+            }
+
+            if (size == max_cache_size) Evict();
+            if (size + deleted >= slot_count - slot_count / 8) Rehash();
+
+            const index_type id = free_head;
+            free_head = next[id];
+            keys[id] = key;
+            values[id] = value;
+            LinkFront(id);
+            Place(id, hash);
+            ++size;
+        }
+
+        // Copy of the value; nullopt on a miss
+        std::optional<Value> TryGet(const Key& key) noexcept
+        {
+            const index_type id = Lookup(key);
+            if (id == none) return std::nullopt;
+            return values[id];
+        }
+
+        // Get value by key, throws if key not found
+        const Value& Get(const Key& key)
+        {
+            const index_type id = Lookup(key);
+            if (id == none)
+            {
+                throw std::range_error("Key not found in cache.");
+            }
+            return values[id];
+        }
+
+        // Whether key is present; doesn't change the eviction order
+        bool Cached(const Key& key) const noexcept { return FindSlot(key, HashOf(key)) != npos; }
+
+        // Remove a key, return true if it existed
+        bool Remove(const Key& key) noexcept
+        {
+            const std::size_t pos = FindSlot(key, HashOf(key));
+            if (pos == npos) return false;
+            Release(pos);
+            return true;
+        }
+
+        void Clear() noexcept
+        {
+            ctrl.fill(detail::ctrl_empty);
+            for (std::size_t i = 0; i < N; ++i) next[i] = static_cast<index_type>(i + 1);
+            next[N] = prev[N] = none;
+            free_head = 0;
+            size = 0;
+            deleted = 0;
+        }
+
+        // Calls visit(key, value) for every entry, oldest first
+        template <typename Visit>
+        void ForEach(Visit&& visit) const
+        {
+            for (index_type id = prev[N]; id != none; id = prev[id]) visit(keys[id], values[id]);
+        }
+
+        std::size_t Size() const noexcept { return size; }
+        std::size_t MaxSize() const noexcept { return max_cache_size; }
+
+    private:
+        static std::uint64_t HashOf(const Key& key) noexcept
+        {
+            return mix_hash(static_cast<std::uint64_t>(Hash{}(key)));
+        }
+
+        static std::int8_t H2(std::uint64_t hash) noexcept { return static_cast<std::int8_t>(hash & 0x7F); }
+        static std::size_t H1(std::uint64_t hash) noexcept { return static_cast<std::size_t>(hash >> 7); }
+
+        // Same triangular group probing as flat_hash_map
+        template <typename Visit>
+        static std::size_t Probe(std::uint64_t hash, Visit visit) noexcept
+        {
+            constexpr std::size_t mask = slot_count / detail::group_width - 1;
+            std::size_t group = H1(hash) & mask;
+            for (std::size_t step = 1;; ++step)
+            {
+                const std::size_t result = visit(group * detail::group_width);
+                if (result != npos) return result;
+                group = (group + step) & mask;
+            }
+        }
+
+        std::size_t FindSlot(const Key& key, std::uint64_t hash) const noexcept
+        {
+            constexpr std::size_t not_found = npos - 1;
+            const std::size_t result = Probe(hash, [&](std::size_t base) -> std::size_t {
+                const detail::ctrl_group group{ctrl.data() + base};
+                for (auto match = group.match(H2(hash)); match; match.clear_lowest())
+                {
+                    const std::size_t pos = base + match.lowest();
+                    if (KeyEqual{}(keys[slot_entry[pos]], key)) return pos;
+                }
+                return group.match_empty() ? not_found : npos;
+            });
+            return result == not_found ? npos : result;
+        }
+
+        // Entry holding key, refreshed per the policy; none on a miss
+        index_type Lookup(const Key& key) noexcept
+        {
+            const std::size_t pos = FindSlot(key, HashOf(key));
+            if (pos == npos) return none;
+            const index_type id = slot_entry[pos];
+            if constexpr (order::touch_on_hit) MoveToFront(id);
+            return id;
+        }
+
+        void Place(index_type id, std::uint64_t hash) noexcept
+        {
+            const std::size_t pos = Probe(hash, [&](std::size_t base) -> std::size_t {
+                const auto free = detail::ctrl_group{ctrl.data() + base}.match_empty_or_deleted();
+                return free ? base + free.lowest() : npos;
+            });
+            if (ctrl[pos] == detail::ctrl_deleted) --deleted;
+            ctrl[pos] = H2(hash);
+            slot_entry[pos] = id;
+        }
+
+        // Frees the entry in slot pos
+        void Release(std::size_t pos) noexcept
+        {
+            const index_type id = slot_entry[pos];
+
+            // As in flat_hash_map: a group that still has an empty byte ends
+            // every probe, so the slot can become empty instead of a tombstone
+            const std::size_t base = pos - pos % detail::group_width;
+            if (detail::ctrl_group{ctrl.data() + base}.match_empty())
+            {
+                ctrl[pos] = detail::ctrl_empty;
+            }
+            else
+            {
+                ctrl[pos] = detail::ctrl_deleted;
+                ++deleted;
+            }
+
+            Unlink(id);
+            next[id] = free_head;
+            free_head = id;
+            --size;
+        }
+
+        void Evict() noexcept
+        {
+            const index_type victim = order::evict_newest ? next[N] : prev[N];
+            Release(FindSlot(keys[victim], HashOf(keys[victim])));
+        }
+
+        // Drops the tombstones; entries stay where they are in the arrays
+        void Rehash() noexcept
+        {
+            ctrl.fill(detail::ctrl_empty);
+            deleted = 0;
+            for (index_type id = next[N]; id != none; id = next[id]) Place(id, HashOf(keys[id]));
+        }
+
+        // Recency list through next/prev; slot N is the sentinel, next[N] the newest entry
+        void LinkFront(index_type id) noexcept
+        {
+            const index_type first = next[N];
+            next[id] = first;
+            prev[id] = none;
+            if (first != none) prev[first] = id;
+            else prev[N] = id;
+            next[N] = id;
+        }
+
+        void Unlink(index_type id) noexcept
+        {
+            const index_type before = prev[id];
+            const index_type after = next[id];
+            if (before != none) next[before] = after;
+            else next[N] = after;
+            if (after != none) prev[after] = before;
+            else prev[N] = before;
+        }
+
+        void MoveToFront(index_type id) noexcept
+        {
+            if (next[N] == id) return;
+            Unlink(id);
+            LinkFront(id);
+        }
+
+        alignas(16) std::array<std::int8_t, slot_count> ctrl;
+        std::array<index_type, slot_count> slot_entry;
+        std::array<Key, N> keys;
+        std::array<Value, N> values;
+        std::array<index_type, N + 1> next; // also chains the free entries
+        std::array<index_type, N + 1> prev;
+        index_type free_head = 0;
+        std::size_t size = 0;
+        std::size_t deleted = 0;
+        std::size_t max_cache_size;
+    };
+
+    /*
+     * static_cache where Key, Value and Policy allow it, fixed_sized_cache
+     * otherwise. Both are constructed from a size (at most N) and share Put,
+     * Get, Cached, Remove, Clear, Size and ForEach.
+     */
+    template <typename Key, typename Value, std::size_t N, template <typename> class Policy = LRUCachePolicy>
+    using small_cache_t =
+        std::conditional_t<is_static_cacheable<Key, Value>::value && detail::static_order<Policy>::supported,
+                           static_cache<Key, Value, N, Policy>, fixed_sized_cache<Key, Value, Policy>>;
+} // namespace caches
+
+#endif
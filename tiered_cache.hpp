@@ -0,0 +1,375 @@
+#ifndef TIERED_CACHE_HPP
+#define TIERED_CACHE_HPP
+
+#include "cache.hpp"
+#include "lru_policy.hpp"
+#include "snapshot.hpp"
+#include "weigher.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace caches
+{
+    // Hit and traffic counters of a tiered_cache
+    struct tiered_counters
+    {
+        std::uint64_t ram_hits = 0;
+        std::uint64_t flash_hits = 0;       // promoted back into RAM
+        std::uint64_t misses = 0;
+        std::uint64_t demotions = 0;        // RAM evictions written to the file tier
+        std::uint64_t demote_errors = 0;    // demotions dropped because the file tier failed
+        std::uint64_t flash_evictions = 0;  // entries overwritten by the log wrapping around
+        std::uint64_t flushes = 0;          // batched appends issued
+    };
+
+    namespace detail
+    {
+        /*
+         * Log-structured file tier: values are appended to a write buffer
+         * and flushed as one sequential pwrite per batch; an in-memory index
+         * maps each key to its extent. The file is used as a ring, so once
+         * it is full the oldest extents are overwritten (FIFO eviction).
+         * Values are encoded with snapshot_codec<Value>.
+         */
+        template <typename Key, typename Value>
+        class log_tier
+        {
+        public:
+            log_tier(const std::string& path, std::size_t capacity, std::size_t batch_bytes)
+                : path{path}, capacity{capacity}, batch_bytes{batch_bytes}
+            {
+                if (capacity == 0 || batch_bytes == 0 || batch_bytes > capacity)
+                {
+                    throw std::invalid_argument{"File tier needs 0 < batch size <= capacity."};
+                }
+                fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+                if (fd < 0)
+                {
+                    throw std::system_error{errno, std::generic_category(), "Cannot open cache file " + path};
+                }
+                pending.reserve(batch_bytes);
+            }
+
+            log_tier(const log_tier&) = delete;
+            log_tier& operator=(const log_tier&) = delete;
+
+            // The file means nothing without the index, so it goes too
+            ~log_tier()
+            {
+                ::close(fd);
+                std::remove(path.c_str());
+            }
+
+            // Returns false when the value is too large to ever fit a batch
+            bool Append(const Key& key, const Value& value, tiered_counters& counters)
+            {
+                Discard(key);
+                const std::size_t size = EncodedSize(value);
+                if (size > batch_bytes) return false;
+
+                if (pending.size() + size > batch_bytes) Flush(counters);
+                if (write_offset + pending.size() + size > capacity)
+                {
+                    Flush(counters);
+                    Wrap(counters);
+                }
+
+                const std::uint64_t offset = write_offset + pending.size();
+                Reclaim(offset, offset + size, counters);
+
+                pending.resize(pending.size() + size);
+                EncodeItem(value, pending.data() + (offset - write_offset));
+                index[key] = extent{offset, static_cast<std::uint32_t>(size)};
+                log.push_back(record{key, offset, static_cast<std::uint32_t>(size)});
+                return true;
+            }
+
+            // Reads and drops key's value, if the tier holds it
+            std::optional<Value> Take(const Key& key)
+            {
+                const auto found = index.find(key);
+                if (found == index.end()) return std::nullopt;
+
+                const extent where = found->second;
+                index.erase(found);
+
+                const char* bytes;
+                if (where.offset >= write_offset && where.offset < write_offset + pending.size())
+                {
+                    bytes = pending.data() + (where.offset - write_offset);
+                }
+                else
+                {
+                    read_buffer.resize(where.size);
+                    ReadAt(read_buffer.data(), where.size, where.offset);
+                    bytes = read_buffer.data();
+                }
+                const char* in = bytes;
+                return DecodeItem<Value>(in, bytes + where.size);
+            }
+
+            bool Contains(const Key& key) const { return index.find(key) != index.end(); }
+
+            // Forgets key; its bytes stay in the log until overwritten
+            bool Discard(const Key& key) { return index.erase(key) != 0; }
+
+            void Flush(tiered_counters& counters)
+            {
+                if (pending.empty()) return;
+
+                std::size_t written = 0;
+                while (written < pending.size())
+                {
+                    const ssize_t n = ::pwrite(fd, pending.data() + written, pending.size() - written,
+                                               static_cast<off_t>(write_offset + written));
+                    if (n < 0)
+                    {
+                        if (errno == EINTR) continue;
+                        throw std::system_error{errno, std::generic_category(), "Cannot write cache file " + path};
+                    }
+                    written += static_cast<std::size_t>(n);
+                }
+                write_offset += pending.size();
+                pending.clear();
+                ++counters.flushes;
+            }
+
+            void Clear()
+            {
+                index.clear();
+                log.clear();
+                pending.clear();
+                write_offset = 0;
+            }
+
+            std::size_t Size() const noexcept { return index.size(); }
+
+        private:
+            struct extent
+            {
+                std::uint64_t offset;
+                std::uint32_t size;
+            };
+
+            struct record
+            {
+                Key key;
+                std::uint64_t offset;
+                std::uint32_t size;
+            };
+
+            // Restart at the beginning of the file; extents past the point
+            // the log wrapped at are the oldest and are dropped with it
+            void Wrap(tiered_counters& counters)
+            {
+                while (!log.empty() && log.front().offset >= write_offset)
+                {
+                    Evict(log.front(), counters);
+                    log.pop_front();
+                }
+                write_offset = 0;
+            }
+
+            // Evicts previous-lap extents until [begin, end) is free
+            void Reclaim(std::uint64_t begin, std::uint64_t end, tiered_counters& counters)
+            {
+                while (!log.empty() && log.front().offset >= begin && log.front().offset < end)
+                {
+                    Evict(log.front(), counters);
+                    log.pop_front();
+                }
+            }
+
+            void Evict(const record& oldest, tiered_counters& counters)
+            {
+                const auto found = index.find(oldest.key);
+                if (found != index.end() && found->second.offset == oldest.offset)
+                {
+                    index.erase(found);
+                    ++counters.flash_evictions;
+                }
+            }
+
+            void ReadAt(char* out, std::size_t size, std::uint64_t offset) const
+            {
+                std::size_t done = 0;
+                while (done < size)
+                {
+                    const ssize_t n = ::pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0)
+                    {
+                        throw std::system_error{n < 0 ? errno : EIO, std::generic_category(),
+                                                "Cannot read cache file " + path};
+                    }
+                    done += static_cast<std::size_t>(n);
+                }
+            }
+
+            std::string path;
+            int fd = -1;
+            std::size_t capacity;
+            std::size_t batch_bytes;
+            std::uint64_t write_offset = 0; // where `pending` goes once flushed
+            std::vector<char> pending;
+            std::vector<char> read_buffer;
+            std::unordered_map<Key, extent> index;
+            // Appended extents in write order. The front holds what is left
+            // of the previous lap, all at or past the next write position;
+            // the current lap follows, all before it.
+            std::deque<record> log;
+        };
+    } // namespace detail
+
+    /*
+     * Two-tier cache: a fixed_sized_cache in RAM in front of a
+     * log-structured file tier (meant for SSD/flash). Entries evicted from
+     * RAM are demoted to the file through the RAM cache's erase callback;
+     * demotions are buffered and written as large sequential appends. A
+     * lookup that misses RAM but hits the file reads the value back with
+     * pread and promotes it into RAM. An entry lives in one tier at a time.
+     * The file is scratch space: it is truncated on construction and
+     * removed on destruction. Not thread-safe, like fixed_sized_cache.
+     * Key - Type of the key (hashable, copyable)
+     * Value - Type of value, written through snapshot_codec<Value>
+     * Policy - Eviction policy of the RAM tier
+     * HashMap - Map container of the RAM tier
+     * Weigher - Entry cost function of the RAM tier
+     */
+    template <typename Key, typename Value, template <typename> class Policy = LRUCachePolicy,
+              typename HashMap = std::unordered_map<Key, Value>, typename Weigher = unit_weigher>
+    class tiered_cache
+    {
+        // Demotes every RAM eviction, except entries removed on purpose
+        class demote_sink
+        {
+        public:
+            explicit demote_sink(tiered_cache* owner) noexcept : owner{owner} {}
+
+            void operator()(const Key& key, const Value& value) const noexcept
+            {
+                if (owner->discarding) return;
+                owner->Demote(key, value);
+            }
+
+        private:
+            tiered_cache* owner;
+        };
+
+    public:
+        using key_type = Key;
+        using mapped_type = Value;
+        using ram_cache_type = fixed_sized_cache<Key, Value, Policy, HashMap, Weigher, no_stats, demote_sink>;
+
+        /*
+         * Constructor
+         * ram_size - Capacity of the RAM tier (entries, or weight with a Weigher)
+         * path - File backing the flash tier; truncated, and removed afterwards
+         * flash_bytes - Size of the file tier's ring
+         * batch_bytes - Demotions are buffered up to this many bytes per write;
+         *               larger values are not demoted
+         */
+        tiered_cache(std::size_t ram_size, const std::string& path, std::size_t flash_bytes,
+                     std::size_t batch_bytes = std::size_t{1} << 20, const Weigher& weigher = Weigher{})
+            : flash{path, flash_bytes, batch_bytes},
+              ram{ram_size, Policy<Key>{}, demote_sink{this}, weigher}
+        {
+        }
+
+        tiered_cache(const tiered_cache&) = delete;
+        tiered_cache& operator=(const tiered_cache&) = delete;
+
+        void Put(const Key& key, const Value& value)
+        {
+            flash.Discard(key);
+            ram.Put(key, value);
+        }
+
+        // Copy of the value from either tier, promoting a file hit into RAM
+        std::optional<Value> TryGet(const Key& key)
+        {
+            const auto resident = ram.TryGet(key);
+            if (resident.second)
+            {
+                ++counters.ram_hits;
+                return resident.first->second;
+            }
+
+            std::optional<Value> value = flash.Take(key);
+            if (!value)
+            {
+                ++counters.misses;
+                return std::nullopt;
+            }
+            ++counters.flash_hits;
+            ram.Put(key, *value);
+            // A weighted RAM tier refuses entries heavier than its budget;
+            // those stay in the file tier
+            if (!ram.Cached(key)) Demote(key, *value);
+            return value;
+        }
+
+        // Whether either tier holds key; doesn't promote it
+        bool Cached(const Key& key) const { return ram.Cached(key) || flash.Contains(key); }
+
+        // Remove a key from both tiers, return true if it existed
+        bool Remove(const Key& key)
+        {
+            discarding = true;
+            const bool in_ram = ram.Remove(key);
+            discarding = false;
+            return flash.Discard(key) || in_ram;
+        }
+
+        void Clear()
+        {
+            ram.Clear();
+            flash.Clear();
+        }
+
+        // Writes buffered demotions to the file now
+        void Flush() { flash.Flush(counters); }
+
+        std::size_t Size() const noexcept { return ram.Size() + flash.Size(); }
+        std::size_t RamSize() const noexcept { return ram.Size(); }
+        std::size_t FlashSize() const noexcept { return flash.Size(); }
+
+        const tiered_counters& Counters() const noexcept { return counters; }
+
+    private:
+        // Runs inside the RAM tier's noexcept Put, so a failed write (ENOSPC,
+        // EIO, ...) loses this one demotion instead of escaping
+        void Demote(const Key& key, const Value& value) noexcept
+        {
+            try
+            {
+                if (flash.Append(key, value, counters)) ++counters.demotions;
+            }
+            catch (const std::exception&)
+            {
+                flash.Discard(key);
+                ++counters.demote_errors;
+            }
+        }
+
+        tiered_counters counters;
+        detail::log_tier<Key, Value> flash; // before `ram`, which demotes into it
+        bool discarding = false;
+        ram_cache_type ram;
+    };
+} // namespace caches
+
+#endif
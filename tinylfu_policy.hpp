@@ -0,0 +1,234 @@
+#ifndef TINYLFU_CACHE_POLICY_HPP
+#define TINYLFU_CACHE_POLICY_HPP
+
+#include "cache_policy.hpp"
+#include "hash_util.hpp"
+#include "key_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+namespace caches
+{
+    /*
+     * Count-min sketch of access frequencies with 4-bit saturating counters.
+     * After every `10 * width` increments all counters are halved, so old
+     * popularity fades and the sketch follows shifts in the workload.
+     */
+    template <typename Key>
+    class frequency_sketch
+    {
+    public:
+        explicit frequency_sketch(std::size_t capacity = 0) { Resize(capacity); }
+
+        // Size for about `capacity` distinct hot keys; resets all counts
+        void Resize(std::size_t capacity)
+        {
+            std::size_t width = 64;
+            while (width < capacity) width *= 2;
+
+            counters.assign(width * depth, 0);
+            mask = width - 1;
+            additions = 0;
+            sample_size = 10 * width;
+        }
+
+        std::size_t Width() const noexcept { return mask + 1; }
+
+        void Increment(const Key& key) noexcept
+        {
+            const std::uint64_t hash = HashOf(key);
+            for (std::size_t row = 0; row < depth; ++row)
+            {
+                std::uint8_t& counter = counters[Slot(hash, row)];
+                if (counter < max_count) ++counter;
+            }
+
+            if (++additions >= sample_size) Age();
+        }
+
+        // Estimated access count, capped at 15
+        std::uint8_t Frequency(const Key& key) const noexcept
+        {
+            const std::uint64_t hash = HashOf(key);
+            std::uint8_t estimate = max_count;
+            for (std::size_t row = 0; row < depth; ++row)
+            {
+                estimate = std::min(estimate, counters[Slot(hash, row)]);
+            }
+            return estimate;
+        }
+
+    private:
+        static constexpr std::size_t depth = 4;
+        static constexpr std::uint8_t max_count = 15;
+
+        static std::uint64_t HashOf(const Key& key) noexcept
+        {
+            return mix_hash(static_cast<std::uint64_t>(std::hash<Key>{}(key)));
+        }
+
+        // Row i uses h1 + i * h2 (double hashing) inside its own row
+        std::size_t Slot(std::uint64_t hash, std::size_t row) const noexcept
+        {
+            const std::uint64_t h2 = (hash >> 32) | 1;
+            return row * (mask + 1) + static_cast<std::size_t>((hash + row * h2) & mask);
+        }
+
+        void Age() noexcept
+        {
+            for (auto& counter : counters) counter >>= 1;
+            additions /= 2;
+        }
+
+        std::vector<std::uint8_t> counters;
+        std::size_t mask = 0;
+        std::size_t additions = 0;
+        std::size_t sample_size = 0;
+    };
+
+    /*
+     * W-TinyLFU Cache Policy
+     * New keys enter a small LRU window (1% of the capacity). When the window
+     * overflows, its oldest key competes with the main region's victim and
+     * the one the frequency sketch has seen less often is evicted, so a scan
+     * of one-hit keys washes through the window without flushing the working
+     * set. The main region is a segmented LRU: keys hit again while on
+     * probation move to the protected segment (80% of the main region).
+     */
+    template <typename Key>
+    class TinyLFUCachePolicy
+    {
+    public:
+        using node_id = typename key_pool<Key>::index_type;
+
+        TinyLFUCachePolicy() = default;
+        ~TinyLFUCachePolicy() noexcept = default;
+
+        void Reserve(std::size_t capacity) {
+            key_nodes.reserve(capacity);
+            SetCapacity(capacity);
+        }
+
+        void Insert(const Key& key) {
+            if (key_nodes.find(key) != key_pool<Key>::npos) return; // prevent duplicate
+
+            // Without a Reserve hint (weighted caches) follow the resident count
+            if (key_nodes.size() + 1 > capacity) SetCapacity(std::max<std::size_t>(2 * capacity, 64));
+
+            sketch.Increment(key);
+            const node_id id = key_nodes.insert(key);
+            Push(window, window_segment, id);
+
+            // Window overflow: its oldest key was admitted into the main region
+            if (window.size > window_limit) {
+                const node_id demoted = window.tail;
+                key_nodes.unlink(window, demoted);
+                Push(probation, probation_segment, demoted);
+            }
+        }
+
+        void Touch(const Key& key) {
+            const node_id id = key_nodes.find(key);
+            if (id == key_pool<Key>::npos) return;
+
+            sketch.Increment(key);
+            switch (key_nodes.tag(id)) {
+            case window_segment:
+                key_nodes.move_to_front(window, id);
+                break;
+            case probation_segment:
+                key_nodes.unlink(probation, id);
+                Push(protected_lru, protected_segment, id);
+                if (protected_lru.size > protected_limit) {
+                    const node_id demoted = protected_lru.tail;
+                    key_nodes.unlink(protected_lru, demoted);
+                    Push(probation, probation_segment, demoted);
+                }
+                break;
+            default:
+                key_nodes.move_to_front(protected_lru, id);
+                break;
+            }
+        }
+
+        void Prefetch(const Key& key) const noexcept {
+            key_nodes.prefetch(key);
+        }
+
+        void Erase(const Key& key) noexcept {
+            const node_id id = key_nodes.find(key);
+            if (id == key_pool<Key>::npos) return;
+
+            key_nodes.unlink(Segment(key_nodes.tag(id)), id);
+            key_nodes.erase(id);
+        }
+
+        const Key& ReplacementCandidate() const {
+            if (key_nodes.empty()) {
+                throw std::runtime_error("No keys available for eviction (W-TinyLFU).");
+            }
+
+            const node_id main_victim = probation.size != 0 ? probation.tail : protected_lru.tail;
+            if (window.size == 0) return key_nodes.key(main_victim);
+            if (main_victim == key_pool<Key>::npos) return key_nodes.key(window.tail);
+
+            // Room left in the window: the next insert won't push anyone out
+            if (window.size < window_limit) return key_nodes.key(main_victim);
+
+            // TinyLFU admission: the window's candidate only displaces the
+            // main victim if it has been seen more often
+            const Key& candidate = key_nodes.key(window.tail);
+            const Key& victim = key_nodes.key(main_victim);
+            return sketch.Frequency(candidate) > sketch.Frequency(victim) ? victim : candidate;
+        }
+
+    private:
+        static constexpr std::uint8_t window_segment = 0;
+        static constexpr std::uint8_t probation_segment = 1;
+        static constexpr std::uint8_t protected_segment = 2;
+
+        void SetCapacity(std::size_t new_capacity) {
+            capacity = std::max<std::size_t>(new_capacity, 1);
+            window_limit = std::max<std::size_t>(capacity / 100, 1);
+            const std::size_t main_capacity = capacity > window_limit ? capacity - window_limit : 1;
+            protected_limit = std::max<std::size_t>(main_capacity * 4 / 5, 1);
+            if (sketch.Width() < capacity) sketch.Resize(capacity);
+
+            // A shrunk capacity leaves the segments over their new limits
+            while (window.size > window_limit) {
+                const node_id demoted = window.tail;
+                key_nodes.unlink(window, demoted);
+                Push(probation, probation_segment, demoted);
+            }
+            while (protected_lru.size > protected_limit) {
+                const node_id demoted = protected_lru.tail;
+                key_nodes.unlink(protected_lru, demoted);
+                Push(probation, probation_segment, demoted);
+            }
+        }
+
+        void Push(typename key_pool<Key>::list& segment, std::uint8_t tag, node_id id) noexcept {
+            key_nodes.push_front(segment, id);
+            key_nodes.set_tag(id, tag);
+        }
+
+        typename key_pool<Key>::list& Segment(std::uint8_t tag) noexcept {
+            return tag == window_segment ? window : tag == probation_segment ? probation : protected_lru;
+        }
+
+        key_pool<Key> key_nodes;
+        typename key_pool<Key>::list window;        // head is the most recent
+        typename key_pool<Key>::list probation;     // main region, seen once since admission
+        typename key_pool<Key>::list protected_lru; // main region, hit again
+        frequency_sketch<Key> sketch;
+        std::size_t capacity = 0;
+        std::size_t window_limit = 1;
+        std::size_t protected_limit = 1;
+    };
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef TWOQ_CACHE_POLICY_HPP
+#define TWOQ_CACHE_POLICY_HPP
+
+#include "cache_policy.hpp"
+#include "key_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace caches
+{
+    /*
+     * 2Q Cache Policy (full version)
+     * New keys enter the FIFO A1in (25% of the capacity). Keys evicted from
+     * A1in are remembered in the ghost FIFO A1out (50% of the capacity); a
+     * key that comes back while still in A1out was re-referenced over a long
+     * period and is promoted into the LRU Am. Keys hit while in A1in are
+     * treated as correlated references and stay put, so short bursts don't
+     * pollute Am.
+     */
+    template <typename Key>
+    class TwoQCachePolicy
+    {
+    public:
+        using node_id = typename key_pool<Key>::index_type;
+
+        TwoQCachePolicy() = default;
+        ~TwoQCachePolicy() noexcept = default;
+
+        void Reserve(std::size_t capacity) {
+            SetCapacity(capacity);
+        }
+
+        void Insert(const Key& key) {
+            node_id id = key_nodes.find(key);
+            if (id != key_pool<Key>::npos && key_nodes.tag(id) != a1out_list) return; // prevent duplicate
+
+            // Without a Reserve hint (weighted caches) follow the resident count
+            if (a1in.size + am.size + 1 > capacity) SetCapacity(std::max<std::size_t>(2 * capacity, 64));
+
+            if (id != key_pool<Key>::npos) {
+                key_nodes.unlink(a1out, id);
+                Push(am, am_list, id);
+            } else {
+                Push(a1in, a1in_list, key_nodes.insert(key));
+            }
+        }
+
+        void Touch(const Key& key) {
+            const node_id id = key_nodes.find(key);
+            if (id == key_pool<Key>::npos) return;
+
+            // Hits in A1in are correlated references: no effect
+            if (key_nodes.tag(id) == am_list) key_nodes.move_to_front(am, id);
+        }
+
+        void Prefetch(const Key& key) const noexcept {
+            key_nodes.prefetch(key);
+        }
+
+        void Erase(const Key& key) noexcept {
+            const node_id id = key_nodes.find(key);
+            if (id == key_pool<Key>::npos) return;
+
+            switch (key_nodes.tag(id)) {
+            case a1in_list:
+                // Remember it, dropping the oldest ghost past Kout
+                key_nodes.unlink(a1in, id);
+                Push(a1out, a1out_list, id);
+                TrimGhosts();
+                break;
+            case am_list:
+                key_nodes.unlink(am, id);
+                key_nodes.erase(id);
+                break;
+            default:
+                break; // already a ghost
+            }
+        }
+
+        const Key& ReplacementCandidate() const {
+            if (a1in.size + am.size == 0) {
+                throw std::runtime_error("No keys available for eviction (2Q).");
+            }
+            if (a1in.size > a1in_limit || am.size == 0) {
+                return key_nodes.key(a1in.tail);
+            }
+            return key_nodes.key(am.tail);
+        }
+
+    private:
+        static constexpr std::uint8_t a1in_list = 0;
+        static constexpr std::uint8_t am_list = 1;
+        static constexpr std::uint8_t a1out_list = 2;
+
+        void SetCapacity(std::size_t new_capacity) {
+            capacity = std::max<std::size_t>(new_capacity, 1);
+            a1in_limit = std::max<std::size_t>(capacity / 4, 1);
+            a1out_limit = std::max<std::size_t>(capacity / 2, 1);
+            key_nodes.reserve(capacity + a1out_limit + 1);
+            TrimGhosts();
+        }
+
+        void TrimGhosts() noexcept {
+            while (a1out.size > a1out_limit) {
+                const node_id ghost = a1out.tail;
+                key_nodes.unlink(a1out, ghost);
+                key_nodes.erase(ghost);
+            }
+        }
+
+        void Push(typename key_pool<Key>::list& l, std::uint8_t tag, node_id id) noexcept {
+            key_nodes.push_front(l, id);
+            key_nodes.set_tag(id, tag);
+        }
+
+        key_pool<Key> key_nodes;
+        typename key_pool<Key>::list a1in;  // resident FIFO of new keys
+        typename key_pool<Key>::list am;    // resident LRU of re-referenced keys
+        typename key_pool<Key>::list a1out; // ghost FIFO of keys evicted from A1in
+        std::size_t capacity = 0;
+        std::size_t a1in_limit = 1;         // Kin
+        std::size_t a1out_limit = 1;        // Kout
+    };
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef WEIGHER_HPP
+#define WEIGHER_HPP
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace caches
+{
+    /*
+     * Default weigher: every entry costs 1, so the cache capacity is an entry
+     * count. fixed_sized_cache special-cases it and keeps its count-based
+     * fast path.
+     */
+    struct unit_weigher
+    {
+        template <typename Key, typename Value>
+        constexpr std::size_t operator()(const Key&, const Value&) const noexcept
+        {
+            return 1;
+        }
+    };
+
+    /*
+     * Approximate number of bytes an object owns: its own size plus any heap
+     * storage of the standard containers below. Overload estimated_size in
+     * the value's namespace for custom types.
+     */
+    template <typename T>
+    std::size_t estimated_size(const T& value) noexcept
+    {
+        (void)value;
+        return sizeof(T);
+    }
+
+    template <typename Char, typename Traits, typename Alloc>
+    std::size_t estimated_size(const std::basic_string<Char, Traits, Alloc>& str) noexcept
+    {
+        // Short strings live in the object itself, up to the capacity an
+        // empty string starts with (15 chars in libstdc++, 22 in libc++)
+        const std::size_t inline_capacity = std::basic_string<Char, Traits, Alloc>{str.get_allocator()}.capacity();
+        const bool inline_storage = str.capacity() <= inline_capacity;
+        return sizeof(str) + (inline_storage ? 0 : (str.capacity() + 1) * sizeof(Char));
+    }
+
+    template <typename T, typename Alloc>
+    std::size_t estimated_size(const std::vector<T, Alloc>& vec) noexcept
+    {
+        std::size_t total = sizeof(vec) + (vec.capacity() - vec.size()) * sizeof(T);
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            total += vec.size() * sizeof(T);
+        }
+        else
+        {
+            for (const auto& item : vec) total += estimated_size(item);
+        }
+        return total;
+    }
+
+    /*
+     * Weighs an entry by the memory its key and value hold, for byte-budgeted
+     * caches: fixed_sized_cache<K, V, Policy, HashMap, memory_weigher> c(64 << 20);
+     */
+    struct memory_weigher
+    {
+        template <typename Key, typename Value>
+        std::size_t operator()(const Key& key, const Value& value) const noexcept
+        {
+            return estimated_size(key) + estimated_size(value);
+        }
+    };
+
+    /*
+     * Approximate bytes a cache holds, by what they are spent on:
+     * table - the map's buckets / slots and per-entry node overhead
+     * policy - the eviction policy's bookkeeping (nodes, index, key copies)
+     * keys / values - estimated_size of the stored keys and values
+     */
+    struct memory_usage
+    {
+        std::size_t table = 0;
+        std::size_t policy = 0;
+        std::size_t keys = 0;
+        std::size_t values = 0;
+
+        std::size_t Total() const noexcept { return table + policy + keys + values; }
+
+        memory_usage& operator+=(const memory_usage& other) noexcept
+        {
+            table += other.table;
+            policy += other.policy;
+            keys += other.keys;
+            values += other.values;
+            return *this;
+        }
+    };
+} // namespace caches
+
+#endif